@@ -0,0 +1,286 @@
+function generateSyntheticDataset(root, varargin)
+% Writes a synthetic Dataset of configurable size, for benchmarking.
+%   Creates a DatasetDescriptor.xml and the Data, Models and Results
+%   folders of a Dataset at root. Scale is set by name-value pairs:
+%
+%     Subjects       number of subjects (default 3)
+%     ContextValues  number of values of each of the two context
+%                    parameters, Assistance and Speed (default 2)
+%     Trials         trials per DatasetElement (default 5)
+%     Frames         frames per trial (default 500)
+%     Markers        markers per trial (default 38)
+%     Rate           sample rate of every file, in Hz (default 100)
+%     Model          .osim file to copy in as each model (default none)
+%     Seed           random seed (default 0)
+%
+%   Markers are written in the format of the shipped Static1.trc, with the
+%   static marker positions of that file moved forward at walking speed.
+%   IK and ID results are written in the format of the shipped
+%   RRA_q_1.sto, with the coordinate trajectories of that file resampled
+%   to the given number of frames. Forces are two ground reaction forces
+%   plus the APO forces and torques expected by the exoskeleton GRF
+%   pipeline. Each trial is perturbed by random noise.
+%
+%   Results are written to <trial>/IK/ik.mot and <trial>/ID/id.sto within
+%   the results folder of each element, as OpenSimTrial expects. The data
+%   are not physically consistent, so OpenSim analyses should not be run
+%   on a synthetic Dataset. Without a Model, model files are empty
+%   placeholders, so the Dataset can be parsed and populated but not
+%   loaded, which creates OpenSimTrial and MotionData objects from the
+%   model.
+
+% Parse the options.
+options = struct('Subjects', 3, 'ContextValues', 2, 'Trials', 5, ...
+    'Frames', 500, 'Markers', 38, 'Rate', 100, 'Model', [], 'Seed', 0);
+for i=1:2:length(varargin)
+    if ~isfield(options, varargin{i})
+        error('Unrecognised option %s.', varargin{i});
+    end
+    options.(varargin{i}) = varargin{i + 1};
+end
+rng(options.Seed);
+
+% Read the templates.
+[kinematics, kinematics_labels, kinematics_header] = ...
+    readOpenSimTable(which('RRA_q_1.sto'));
+[static, static_labels, markers_header] = ...
+    readOpenSimTable(which('Static1.trc'));
+
+% Write the descriptor, the models and the loads.
+subjects = 1:options.Subjects;
+levels = 1:options.ContextValues;
+writeDescriptor(root, subjects, levels);
+model_folder = [root filesep 'Models'];
+writeModel(options.Model, [model_folder filesep 'human.osim']);
+writeText([model_folder filesep 'load.xml'], ...
+    sprintf('<?xml version="1.0" encoding="UTF-8" ?>\n'));
+for subject = subjects
+    writeModel(options.Model, [model_folder filesep ...
+        'Subject' num2str(subject) filesep 'model.osim']);
+end
+
+% Write the trials of each element.
+time = (0:options.Frames - 1).'/options.Rate;
+for subject = subjects
+    for assistance = levels
+        for speed = levels
+            name = sprintf('Subject%d%sAssistance%d%sSpeed%d', ...
+                subject, filesep, assistance, filesep, speed);
+            data = [root filesep 'Data' filesep name];
+            results = [root filesep 'Results' filesep name];
+            for trial = 1:options.Trials
+                trial_name = sprintf('Trial%02d', trial);
+                [values, labels] = synthesiseMarkers(...
+                    static, static_labels, options.Markers, time);
+                writeOpenSimTable([createFolder([data filesep ...
+                    'Markers']) filesep trial_name '.trc'], ...
+                    values, labels, markers_header);
+                [values, labels] = synthesiseForces(time);
+                writeOpenSimTable([createFolder([data filesep ...
+                    'Forces']) filesep trial_name '.mot'], ...
+                    values, labels, {'Forces', 'version=1', 'nRows=', ...
+                    'nColumns=', 'inDegrees=yes'});
+                [values, labels] = synthesiseKinematics(...
+                    kinematics, kinematics_labels, time);
+                writeOpenSimTable([createFolder([results filesep ...
+                    trial_name filesep 'IK']) filesep 'ik.mot'], ...
+                    values, labels, kinematics_header);
+                labels(2:end) = strcat(labels(2:end), '_moment');
+                values(:, 2:end) = 50*values(:, 2:end)./ ...
+                    max(abs(values(:, 2:end)) + eps);
+                writeOpenSimTable([createFolder([results filesep ...
+                    trial_name filesep 'ID']) filesep 'id.sto'], ...
+                    values, labels, {'Inverse Dynamics', 'version=1', ...
+                    'nRows=', 'nColumns=', 'inDegrees=no'});
+            end
+        end
+    end
+end
+
+end
+
+function [values, labels] = synthesiseMarkers(static, labels, n_markers, time)
+% Static marker positions moving forward at walking speed, with noise.
+%   Markers beyond those of the template repeat its markers under new
+%   names.
+
+n_template = (size(static, 2) - 2)/3;
+positions = mean(static(:, 3:end), 1);
+index = mod(0:n_markers - 1, n_template);
+columns = reshape([3*index + 1; 3*index + 2; 3*index + 3], 1, []);
+n_frames = length(time);
+
+% Forward (Z in the template) progression and vertical (Y) bob.
+values = repmat(positions(columns), n_frames, 1);
+values(:, 3:3:end) = values(:, 3:3:end) + 1200*time;
+values(:, 2:3:end) = values(:, 2:3:end) + 20*sin(4*pi*time);
+values = values + randn(size(values));
+values = [(1:n_frames).', time, values];
+
+% Labels, renaming the repeated markers.
+names = labels(5:3:end);
+names = cellfun(@(x) x(1:end - 1), names, 'UniformOutput', false);
+names = names(index + 1);
+for i=n_template + 1:n_markers
+    names{i} = sprintf('%s_%d', names{i}, ceil(i/n_template));
+end
+labels = [labels(1:2), reshape(strcat([names; names; names], ...
+    repmat({'X'; 'Y'; 'Z'}, 1, n_markers)), 1, [])];
+
+end
+
+function [values, labels] = synthesiseKinematics(template, labels, time)
+% Template coordinates resampled to the given times, with noise.
+
+n_frames = length(time);
+source = linspace(0, 1, size(template, 1));
+values = interp1(source, template(:, 2:end), linspace(0, 1, n_frames));
+values = values.*(1 + 0.05*randn(1, size(values, 2))) + ...
+    0.1*randn(size(values));
+values = [time, values];
+
+end
+
+function [values, labels] = synthesiseForces(time)
+% Two ground reaction forces and the APO forces and torques.
+%   Stance lasts 60% of each one second gait cycle. The APO torque is a
+%   single cycle with one peak of each sign across the trial, as expected
+%   by identifyLoadingZones.
+
+bodies = {'ground', '1_ground', 'apo', '1_apo', 'apo_group', ...
+    '1_apo_group'};
+suffixes = {'force_vx', 'force_vy', 'force_vz', 'force_px', ...
+    'force_py', 'force_pz', 'torque_x', 'torque_y', 'torque_z'};
+labels = {'time'};
+for i=1:length(bodies)
+    labels = [labels, strcat(bodies{i}, '_', suffixes)];
+end
+values = zeros(length(time), length(labels));
+values(:, 1) = time;
+
+% Ground reaction forces, offset by half a cycle between feet.
+for foot = 0:1
+    phase = mod(time + 0.5*foot, 1)/0.6;
+    stance = phase < 1;
+    offset = 1 + 9*foot;
+    values(:, offset + 1) = 100*stance.*sin(2*pi*phase);
+    values(:, offset + 2) = 700*stance.*sin(pi*phase);
+    values(:, offset + 4) = 1.2*time + 0.25*stance.*phase;
+    values(:, offset + 6) = 0.1*(2*foot - 1);
+end
+
+% APO torques, and the axial forces they produce on a 0.23m arm.
+torque = 10*sin(2*pi*time/(time(end) + eps));
+values(:, [28, 37]) = [torque, -torque];
+values(:, [21, 30]) = values(:, [28, 37])/0.23;
+values(:, [46, 55]) = -values(:, [28, 37]);
+values(:, 2:end) = values(:, 2:end) + 0.01*randn(length(time), 54);
+
+end
+
+function writeDescriptor(root, subjects, levels)
+% Write a DatasetDescriptor.xml in the format of the default descriptor.
+
+value_string = num2str(levels);
+lines = {'<?xml version="1.0" encoding="UTF-8" ?>', ...
+    '<DatasetDescriptor Version="0.1">', ...
+    '    <Name> Synthetic </Name>', ...
+    '    <Type> GaitCycles </Type>', ...
+    '    <Strings>', ...
+    '        <SubjectPrefix> Subject </SubjectPrefix>', ...
+    '        <DataFolderName> Data </DataFolderName>', ...
+    '        <MarkersFolderName> Markers </MarkersFolderName>', ...
+    '        <ForcesFolderName> Forces </ForcesFolderName>', ...
+    '        <ModelFolderName> Models </ModelFolderName>', ...
+    '        <AdjustmentFolderName> Adjustment </AdjustmentFolderName>', ...
+    '        <ResultsFolderName> Results </ResultsFolderName>', ...
+    '    </Strings>', ...
+    '    <ProcessingInformation>', ...
+    '        <Delay> 0 </Delay>', ...
+    '        <MarkerCutoff> 6 </MarkerCutoff>', ...
+    '        <GRFCutoff> 15 </GRFCutoff>', ...
+    '        <Coordinates>', ...
+    '            <Markers>', ...
+    '                <Forward> +z </Forward>', ...
+    '                <Upwards> +y </Upwards>', ...
+    '                <Right> -x </Right>', ...
+    '            </Markers>', ...
+    '            <GRF>', ...
+    '                <Forward> +x </Forward>', ...
+    '                <Upwards> +y </Upwards>', ...
+    '                <Right> +z </Right>', ...
+    '            </GRF>', ...
+    '        </Coordinates>', ...
+    '    </ProcessingInformation>', ...
+    '    <SubjectInformation>', ...
+    ['        <Subjects> ' num2str(subjects) ' </Subjects>'], ...
+    ['        <LegLengths> ' num2str(0.9 + 0.05*rand(size(subjects)), ...
+    '%.3f ') ' </LegLengths>'], ...
+    ['        <ToeLengths> ' num2str(0.07 + 0.03*rand(size(subjects)), ...
+    '%.3f ') ' </ToeLengths>'], ...
+    '    </SubjectInformation>', ...
+    '    <ContextParameters>', ...
+    '        <ModelParameter> Assistance </ModelParameter>', ...
+    '        <Parameter>', ...
+    '            <Name> Assistance </Name>', ...
+    ['            <Values> ' value_string ' </Values>'], ...
+    '        </Parameter>', ...
+    '        <Parameter>', ...
+    '            <Name> Speed </Name>', ...
+    ['            <Values> ' value_string ' </Values>'], ...
+    '            <AdjustmentValue> 1 </AdjustmentValue>', ...
+    '        </Parameter>', ...
+    '    </ContextParameters>', ...
+    '    <ModelSet>', ...
+    '        <HumanModel> human.osim </HumanModel>', ...
+    '        <AdjustmentSuffix> _adjusted </AdjustmentSuffix>', ...
+    '        <Model>', ...
+    '            <Name> model.osim </Name>', ...
+    ['            <ParameterValues> ' value_string ' </ParameterValues>'], ...
+    '            <AdjustmentValue> 1 </AdjustmentValue>', ...
+    '        </Model>', ...
+    '    </ModelSet>', ...
+    '    <LoadSet>', ...
+    '        <Load>', ...
+    '            <Name> load.xml </Name>', ...
+    ['            <ParameterValues> ' value_string ' </ParameterValues>'], ...
+    '        </Load>', ...
+    '    </LoadSet>', ...
+    '</DatasetDescriptor>'};
+writeText([createFolder(root) filesep 'DatasetDescriptor.xml'], ...
+    sprintf('%s\n', lines{:}));
+
+end
+
+function writeModel(model, path)
+% Copy the given model to path, or write an empty placeholder.
+
+createFolder(fileparts(path));
+if isempty(model)
+    writeText(path, '');
+else
+    copyfile(model, path);
+end
+
+end
+
+function writeText(path, text)
+% Write a string to a file.
+
+fid = fopen(path, 'w');
+if fid == -1
+    error('Unable to open %s for writing.', path);
+end
+fwrite(fid, text, 'char');
+fclose(fid);
+
+end
+
+function folder = createFolder(folder)
+% Create a folder if it doesn't already exist.
+
+if exist(folder, 'dir') ~= 7
+    mkdir(folder);
+end
+
+end
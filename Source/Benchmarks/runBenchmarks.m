@@ -0,0 +1,212 @@
+function results = runBenchmarks(output, varargin)
+% Times the main stages of DRAM on a synthetic Dataset.
+%   Generates a synthetic Dataset (see generateSyntheticDataset) and times
+%   parsing the DatasetDescriptor, populating the Dataset, checking loadData
+%   against Data on its tables (see verifyDataIO), loading it,
+%   computing a metric, the MetricStats2D analysis of that metric and the
+%   exoskeleton GRF pipeline. Each stage is run Repeats times. One row per
+%   stage is appended to the CSV file at output, recording the commit and
+%   MATLAB version, the scale of the Dataset and the median and minimum
+%   time of the stage, so that results can be compared between versions.
+%   The same rows are returned as a table.
+%
+%   Options are given as name-value pairs:
+%
+%     Repeats   times each stage is run (default 3)
+%     Root      an existing synthetic Dataset to use; by default one is
+%               generated in a temporary folder and removed afterwards
+%     Analyses  analyses to load (default {'Markers', 'GRF', 'IK', 'ID'})
+%     Metric    metric to compute (default @calculateROM)
+%     Args      arguments of the metric (default {'hip_flexion_r'})
+%
+%   Any other options are passed to generateSyntheticDataset. Loading
+%   creates OpenSimTrial and MotionData objects, which need a real model,
+%   so unless the Dataset has one, e.g. from the Model option of
+%   generateSyntheticDataset, the load and compute stages are skipped and
+%   recorded as such. Note that Dataset.compute assumes 5 trials per
+%   element. A stage which errors is recorded with the error message as
+%   its status, and stages after it still run. If compute fails or is
+%   skipped, MetricStats2D is timed on random observations of the same
+%   size. Repeats records the number of completed runs of each stage.
+
+% Parse the options.
+options = struct('Repeats', 3, 'Root', [], ...
+    'Analyses', {{'Markers', 'GRF', 'IK', 'ID'}}, ...
+    'Metric', @calculateROM, 'Args', {{'hip_flexion_r'}});
+scale = struct('Subjects', 3, 'ContextValues', 2, 'Trials', 5, ...
+    'Frames', 500, 'Markers', 38);
+generator_options = {};
+for i=1:2:length(varargin)
+    if isfield(options, varargin{i})
+        options.(varargin{i}) = varargin{i + 1};
+    else
+        generator_options = [generator_options, varargin(i:i + 1)];
+        if isfield(scale, varargin{i})
+            scale.(varargin{i}) = varargin{i + 1};
+        end
+    end
+end
+repeats = options.Repeats;
+names = {};
+times = {};
+messages = {};
+
+% Generate the Dataset.
+root = options.Root;
+if isempty(root)
+    root = tempname();
+    [names{end + 1}, times{end + 1}, messages{end + 1}] = ...
+        timeStage('generate', ...
+        @() generateSyntheticDataset(root, generator_options{:}), 1);
+    cleanup = onCleanup(@() rmdir(root, 's'));
+end
+
+% Parse the descriptor alone, then populate a parsed Dataset.
+[names{end + 1}, times{end + 1}, messages{end + 1}] = timeStage(...
+    'parseDatasetDescriptor', @() Dataset(root, false), repeats);
+dataset = [];
+    function parseDataset()
+        dataset = Dataset(root, false);
+    end
+    function populateDataset()
+        dataset.populate();
+    end
+[names{end + 1}, times{end + 1}, messages{end + 1}] = timeStage(...
+    'populate', @populateDataset, repeats, @parseDataset);
+dataset = Dataset(root);
+
+% Check the fast reader against Data on every table, timing it once.
+tables = [dir([root filesep '**' filesep '*.trc']); ...
+    dir([root filesep '**' filesep '*.mot']); ...
+    dir([root filesep '**' filesep '*.sto'])];
+tables = strcat({tables.folder}, filesep, {tables.name});
+[names{end + 1}, times{end + 1}, messages{end + 1}] = timeStage(...
+    'verifyDataIO', @() verifyDataIO(tables), 1);
+
+% Load and compute, if the Dataset has a model to load with.
+observations = [];
+    function computeObservations()
+        observations = dataset.compute(options.Metric, options.Args);
+    end
+model = dir(dataset.Elements(1).ModelPath);
+if isempty(model) || model.bytes == 0
+    reason = 'skipped: the Dataset has no model, see the Model option';
+    [names{end + 1}, times{end + 1}, messages{end + 1}] = ...
+        skipStage('load', reason);
+    [names{end + 1}, times{end + 1}, messages{end + 1}] = ...
+        skipStage('compute', reason);
+else
+    [names{end + 1}, times{end + 1}, messages{end + 1}] = timeStage(...
+        'load', @() dataset.load(options.Analyses), repeats);
+    [names{end + 1}, times{end + 1}, messages{end + 1}] = timeStage(...
+        'compute', @computeObservations, repeats);
+end
+
+% MetricStats2D, using random observations if compute didn't run.
+sample_size = scale.Subjects*5;
+if isempty(observations)
+    observations = randn(scale.ContextValues*sample_size, ...
+        scale.ContextValues);
+end
+[names{end + 1}, times{end + 1}, messages{end + 1}] = timeStage(...
+    'MetricStats2D', @() MetricStats2D('benchmark', observations, ...
+    sample_size, 'speed', 'assistance'), repeats);
+
+% Exoskeleton GRF pipeline, on fresh copies of the forces each time.
+scratch = tempname();
+    function copyForces()
+        if exist(scratch, 'dir') == 7
+            rmdir(scratch, 's');
+        end
+        for j=1:length(dataset.Elements)
+            copyfile(dataset.Elements(j).ForcesFolderPath, ...
+                [scratch filesep num2str(j)]);
+        end
+    end
+    function makeCompliant()
+        files = dir([scratch filesep '**' filesep '*.mot']);
+        for j=1:length(files)
+            makeGRFsCompliant([files(j).folder filesep files(j).name], ...
+                0.55, 0.75, 21);
+        end
+    end
+[names{end + 1}, times{end + 1}, messages{end + 1}] = timeStage(...
+    'GRFPipeline', @makeCompliant, repeats, @copyForces);
+if exist(scratch, 'dir') == 7
+    rmdir(scratch, 's');
+end
+
+% Identify this version.
+[status, commit] = system(['git -C "' ...
+    fileparts(fileparts(fileparts(mfilename('fullpath')))) ...
+    '" rev-parse --short HEAD']);
+if status ~= 0
+    commit = 'unknown';
+end
+
+% Record the results.
+n_stages = length(names);
+Date = repmat({datestr(now, 'yyyy-mm-dd HH:MM:SS')}, n_stages, 1);
+Commit = repmat({strtrim(commit)}, n_stages, 1);
+MATLAB = repmat({version('-release')}, n_stages, 1);
+Stage = names.';
+Subjects = repmat(scale.Subjects, n_stages, 1);
+ContextValues = repmat(scale.ContextValues, n_stages, 1);
+Trials = repmat(scale.Trials, n_stages, 1);
+Frames = repmat(scale.Frames, n_stages, 1);
+Markers = repmat(scale.Markers, n_stages, 1);
+Repeats = cellfun(@(x) nnz(~isnan(x)), times).';
+Median = cellfun(@median, times).';
+Min = cellfun(@min, times).';
+Status = messages.';
+results = table(Date, Commit, MATLAB, Stage, Subjects, ContextValues, ...
+    Trials, Frames, Markers, Repeats, Median, Min, Status);
+
+fid = fopen(output, 'a');
+if fid == -1
+    error('Unable to open %s for writing.', output);
+end
+if ftell(fid) == 0
+    fprintf(fid, '%s\n', strjoin(results.Properties.VariableNames, ','));
+end
+for i=1:n_stages
+    fprintf(fid, '%s,%s,%s,%s,%d,%d,%d,%d,%d,%d,%.6f,%.6f,"%s"\n', ...
+        Date{i}, Commit{i}, MATLAB{i}, Stage{i}, Subjects(i), ...
+        ContextValues(i), Trials(i), Frames(i), Markers(i), ...
+        Repeats(i), Median(i), Min(i), regexprep(Status{i}, '["\n]', ' '));
+end
+fclose(fid);
+
+end
+
+function [name, times, message] = skipStage(name, reason)
+% Record a stage which wasn't run, and why.
+
+times = NaN;
+message = reason;
+fprintf('%s: %s\n', name, message);
+
+end
+
+function [name, times, message] = timeStage(name, func, repeats, setup)
+% Time repeated runs of a stage, running setup untimed before each.
+%   Stops at the first error, returning NaN and the error message.
+
+times = NaN(1, repeats);
+message = 'ok';
+try
+    for i=1:repeats
+        if nargin == 4
+            setup();
+        end
+        timer = tic;
+        func();
+        times(i) = toc(timer);
+    end
+catch err
+    times(:) = NaN;
+    message = err.message;
+end
+fprintf('%s: %s\n', name, message);
+
+end
@@ -0,0 +1,37 @@
+function verifyDataIO(paths)
+% Checks that loadData and writeData agree with the Data class.
+%   Paths is a cell array of .sto/.mot or .trc files. For each, the Values,
+%   Labels, Timesteps, Frames and isTimeSeries of loadData(path) must equal
+%   those of Data(path), with NaN matching NaN. For .sto/.mot files, Data(path)
+%   is also written to a temporary file by writeData, and reading that back
+%   by Data must give the same fields and Header. Errors on the first
+%   difference found, naming the file and property.
+
+fields = {'Values', 'Labels', 'Timesteps', 'Frames', 'isTimeSeries'};
+for i=1:length(paths)
+    fast = loadData(paths{i});
+    reference = Data(paths{i});
+    for j=1:length(fields)
+        if ~isequaln(fast.(fields{j}), reference.(fields{j}))
+            error('loadData and Data differ in %s of %s.', ...
+                fields{j}, paths{i});
+        end
+    end
+
+    % Round trip through writeData.
+    [~, ~, ext] = fileparts(paths{i});
+    if ~strcmpi(ext, '.trc')
+        temp = [tempname() ext];
+        writeData(reference, temp);
+        written = Data(temp);
+        delete(temp);
+        for field=[fields, {'Header'}]
+            if ~isequaln(written.(field{1}), reference.(field{1}))
+                error('writeData does not preserve %s of %s.', ...
+                    field{1}, paths{i});
+            end
+        end
+    end
+end
+
+end
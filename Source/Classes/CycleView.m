@@ -0,0 +1,90 @@
+classdef CycleView
+    % CycleView A gait cycle which refers to the data of its trial.
+    %   Rather than copying every channel of a trial in to a new object, a
+    %   CycleView holds its parent TrialStore and the range of frames of
+    %   each table which fall within the cycle. Data is sliced from the
+    %   store when read, so a trial split in to hundreds of cycles costs
+    %   only their frame ranges.
+    %
+    %   Writing to a table of a view, with setColumn, first copies that
+    %   table's frames in to the view. The store, and so every other view of
+    %   the trial, is unchanged. CycleView is a value class, so as for any
+    %   MATLAB array the written view must be assigned back.
+    
+    properties (SetAccess = private)
+        Store % Parent TrialStore.
+        Side % Side of the heel strikes bounding the cycle.
+        Range % Start and end times of the cycle.
+        Frames = struct() % First and last frames of each table.
+    end
+    
+    properties (SetAccess = private, GetAccess = private)
+        Copies = struct() % Copies of tables which have been written to.
+    end
+    
+    methods
+    
+        function obj = CycleView(store, range, side)
+            % Create a view of the cycle of a TrialStore between two times.
+            if nargin > 0
+                obj.Store = store;
+                obj.Range = range;
+                obj.Side = side;
+                names = store.getTableNames();
+                for i=1:length(names)
+                    obj.Frames.(names{i}) = ...
+                        store.findFrames(names{i}, range);
+                end
+            end
+        end
+        
+        function time = getTime(obj, name)
+            % Time of each frame of a table within the cycle.
+            frames = obj.Frames.(name);
+            time = obj.Store.Tables.(name).Time(frames(1):frames(2));
+        end
+        
+        function labels = getLabels(obj, name)
+            % Labels of the channels of a table.
+            labels = obj.Store.Tables.(name).Labels;
+        end
+        
+        function values = getColumns(obj, name, labels)
+            % Values of a cell array of channels of a table in the cycle.
+            columns = obj.Store.findColumns(name, labels);
+            if isfield(obj.Copies, name)
+                values = obj.Copies.(name)(:, columns);
+            else
+                frames = obj.Frames.(name);
+                values = obj.Store.Tables.(name).Values(...
+                    frames(1):frames(2), columns);
+            end
+        end
+        
+        function values = getColumn(obj, name, label)
+            % Values of a single channel of a table in the cycle.
+            values = obj.getColumns(name, {label});
+        end
+        
+        function values = getTable(obj, name)
+            % Values of every channel of a table in the cycle.
+            values = obj.getColumns(name, obj.getLabels(name));
+        end
+        
+        function obj = setColumn(obj, name, label, values)
+            % Overwrite a channel of a table in this view only.
+            if ~isfield(obj.Copies, name)
+                obj.Copies.(name) = obj.getTable(name);
+            end
+            column = obj.Store.findColumns(name, {label});
+            obj.Copies.(name)(:, column) = values;
+        end
+        
+        function n = getNFrames(obj, name)
+            % Number of frames of a table in the cycle.
+            n = diff(obj.Frames.(name)) + 1;
+        end
+    
+    end
+
+end
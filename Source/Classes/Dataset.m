@@ -29,10 +29,14 @@ classdef Dataset < handle
     end
     
     properties %(Access = {?DatasetElement, ?Dataset})
-        Type = 'GaitCycles'
+        Type = 'GaitCycles' % Motion, Gait, GaitCycles or CycleViews.
         Delay
         MarkerSystem
         GRFSystem
+        MarkerRotation % Rotates marker data in to the OpenSim frame.
+        GRFRotation % Rotates GRF data in to the OpenSim frame.
+        MarkerCutoff % Low-pass cutoff (Hz) of marker data, or empty.
+        GRFCutoff % Low-pass cutoff (Hz) of GRF data, or empty.
         LegLengths
         ToeLengths
         NContextParameters
@@ -51,24 +55,90 @@ classdef Dataset < handle
         HumanModel
         AdjustmentParameterValues
         DatasetRoot
+        TraceFolder % Folder to write a TraceLog to, or empty to disable.
+        ScratchFolder % Folder for OpenSim intermediates, default tempdir.
+        ToolSettings = struct() % Setup files of analyses to run by ToolPool.
+        IKChunkFrames % Frames per chunk of chunked IK, or empty to disable.
+        IKChunkOverlap = 20 % Frames solved before each chunk and discarded.
+        RRALeadIn = 0.25 % Seconds solved before each monitored RRA chunk.
+        PrefetchDepth = 2 % Trials ahead whose input files are prefetched.
+        CycleStore % NormalisedCycleStore built by buildCycleStore.
+        FootPlates = {'ground_force', '1_ground_force'} % Right, left GRFs.
+        EventThresholds = [50 20] % Contact on/off thresholds (N).
     end
     
     methods
          
-        function obj = Dataset(root)
+        function obj = Dataset(root, populate)
             % Constructor for Dataset objects. 
             %   The varargin entry should represent a desired parameter list,
             %   provided as a set of name-value pairs i.e. the name of a
             %   parameter followed by a vector of values which that parameter
-            %   should take within this dataset.
+            %   should take within this dataset. If populate is false the
+            %   DatasetElements are not created, which is used to time the
+            %   parsing of the DatasetDescriptor alone.
         
             if nargin > 0
                 obj.DatasetRoot = root;
                 obj.parseDatasetDescriptor();
-                obj.populate();
+                if nargin < 2 || populate
+                    obj.populate();
+                end
             end
         end
         
+        function populate(obj)
+            % Create and store the DatasetElements which populate this Dataset.
+            %   Called by the constructor unless populate is false, e.g. so
+            %   that populating can be timed on its own.
+            
+            % Create all possible combinations of the context parameters.
+            params = obj.getDesiredParameterValues();
+            combos = combvec(obj.getDesiredSubjectValues(), params{1, :});
+            n_combinations = size(combos, 2);
+            
+            % Initialise an empty cell array to store the DatasetElements. 
+            elements(n_combinations) = DatasetElement;
+            obj.Elements = elements;
+            
+            % Create each DatasetElement in turn. 
+            for i=1:n_combinations
+                % Create a DatasetElement.
+                obj.Elements(i) = DatasetElement(...
+                    obj, combos(1, i), combos(2:end, i));
+            end
+            
+        end
+        
+        function set.DatasetRoot(obj, root)
+            % Paths are kept absolute, since analyses are run with a
+            % scratch folder as the working directory.
+            obj.DatasetRoot = Dataset.getAbsolutePath(root);
+        end
+        
+        function set.TraceFolder(obj, folder)
+            if ~isempty(folder)
+                folder = Dataset.getAbsolutePath(folder);
+            end
+            obj.TraceFolder = folder;
+        end
+        
+        function set.ScratchFolder(obj, folder)
+            if ~isempty(folder)
+                folder = Dataset.getAbsolutePath(folder);
+            end
+            obj.ScratchFolder = folder;
+        end
+        
+        function set.ToolSettings(obj, settings)
+            analyses = fieldnames(settings);
+            for i=1:length(analyses)
+                settings.(analyses{i}) = ...
+                    Dataset.getAbsolutePath(settings.(analyses{i}));
+            end
+            obj.ToolSettings = settings;
+        end
+        
         function performModelAdjustment(obj)
             % Corrects for dynamic inconsistency in the model using RRA.
             %   This function performs RRA analyses (and the IK analyses which
@@ -83,11 +153,16 @@ classdef Dataset < handle
             
             model_vals = obj.getModelAdjustmentValues();
             non_model_vals = obj.AdjustmentParameterValues;
+            trace = TraceLog(obj.TraceFolder);
             for subject = obj.getDesiredSubjectValues()
                 for model = 1:length(model_vals)
                     non_model_vals(obj.ModelParameterIndex) = model_vals(model);
                     element = DatasetElement(obj, subject, non_model_vals);
+                    event = trace.start('performModelAdjustment', ...
+                        element.getTraceName(), 0, 'RRA', ...
+                        element.getTrialInputs(1));
                     element.performModelAdjustment();
+                    trace.finish(event, {element.AdjustedModelPath});
                 end
             end
             obj.ModelAdjustmentCompleted = true;
@@ -107,10 +182,302 @@ classdef Dataset < handle
             % Function to run - batch OpenSim processing.
             func = @runAnalyses;
             
+            % Run IK across the whole pool first if chunked IK is enabled,
+            % on the remaining elements only if resuming.
+            if ~isempty(obj.IKChunkFrames) && strcmp(analyses{1}, 'IK')
+                elements = 1:length(obj.Elements);
+                if ~isempty(varargin)
+                    elements = varargin{1};
+                end
+                obj.runChunkedIK(elements);
+                analyses = analyses(2:end);
+                if isempty(analyses)
+                    [obj.Elements(elements).Processed] = deal(true);
+                    return;
+                end
+            end
+            
             % Perform dataLoop.
             obj.dataLoop(func, analyses, varargin{:});    
         end
         
+        function aborted = processMonitored(obj, analyses, window)
+            % Performs OpenSim processing, aborting runs with bad residuals.
+            %   As process, but each trial is run as a separate task, and
+            %   RRA is first tried in chunks of window seconds (default 0.5)
+            %   whose residuals are checked as each chunk completes, see
+            %   DatasetElement.runChunkedRRA. A task whose residuals already
+            %   exceed a 'bad' MAX threshold of RRAResiduals stops at once,
+            %   freeing its worker for the next task. Otherwise a full RRA
+            %   is run and committed, and the task stops if its residuals
+            %   are graded bad. Requires an RRA setup file in ToolSettings,
+            %   which is used for both the chunks and the full run. Returns
+            %   a table of the aborted trials. Elements with no aborted
+            %   trials are marked processed.
+            
+            if nargin < 3
+                window = 0.5;
+            end
+            
+            % Extract any archived results before trials of the same element
+            % run on different workers.
+            for i=1:length(obj.Elements)
+                obj.Elements(i).unpackResults();
+            end
+            
+            % Create one task per trial.
+            pool = gcp();
+            n_trials = arrayfun(@(x) length(x.Trials), obj.Elements);
+            n_tasks = sum(n_trials);
+            element_index = repelem(1:length(obj.Elements), n_trials);
+            futures(n_tasks) = parallel.FevalFuture;
+            k = 1;
+            for i=1:length(obj.Elements)
+                for j=1:n_trials(i)
+                    futures(k) = parfeval(pool, @runMonitoredTrial, 1, ...
+                        obj.Elements(i), analyses, j, window);
+                    k = k + 1;
+                end
+            end
+            
+            % Collect the grade of each task as it finishes.
+            fprintf('Beginning monitored processing.\n');
+            abandoned = false(1, n_tasks);
+            for n=1:n_tasks
+                [k, grade] = fetchNext(futures);
+                abandoned(k) = strcmp(grade, 'bad');
+            end
+            
+            % Record processed elements and summarise aborted trials.
+            rows = [];
+            for i=1:length(obj.Elements)
+                element_abandoned = abandoned(element_index == i);
+                obj.Elements(i).Processed = ~any(element_abandoned);
+                for j=find(element_abandoned)
+                    row.Subject = obj.Elements(i).Subject;
+                    for p=1:obj.NContextParameters
+                        row.(obj.ContextParameters{p}) = ...
+                            obj.Elements(i).ParameterValues(p);
+                    end
+                    row.Trial = j;
+                    row.Grade = 'bad';
+                    rows = [rows; row];
+                end
+            end
+            if isempty(rows)
+                aborted = table();
+            else
+                aborted = struct2table(rows);
+            end
+            fprintf('Data processing complete.\n');
+        end
+        
+        function processLoadVariants(obj, values)
+            % Run inverse dynamics under several load sets at once.
+            %   For each trial, the IK kinematics are run through batched
+            %   inverse dynamics (see runBatchedID) under the load set of
+            %   each of the given model parameter values in the LoadMap,
+            %   e.g. both the normal and APO load sets. The kinematics are
+            %   filtered and differentiated as by the ID setup file in
+            %   ToolSettings, which is required, and shared by every load
+            %   set. Frames are split across the pool, so elements are
+            %   processed one at a time. Results are written to the ID
+            %   folder of each trial as id_<load name>.sto.
+            
+            fprintf('Beginning batched ID.\n');
+            for i=1:length(obj.Elements)
+                obj.Elements(i).runLoadVariants(values);
+            end
+            fprintf('Batched ID complete.\n');
+        end
+        
+        function indexGaitEvents(obj)
+            % Detect the gait events of every trial in the Dataset.
+            %   The heel strikes and toe offs of each trial are detected
+            %   from its GRFs, or its markers if needed (see
+            %   detectGaitEvents), and stored in the Events property of each
+            %   DatasetElement. The GRFs under each foot are given by
+            %   FootPlates and contact by EventThresholds. Events are cached
+            %   per trial, so this is cheap to repeat. Elements are indexed
+            %   in parallel. Loading a CycleViews Dataset also indexes its
+            %   events.
+            
+            obj.dataLoop(@indexGaitEvents, {});
+        end
+        
+        function store = buildCycleStore(obj, tables, samples)
+            % Build the time-normalised cycles of the whole Dataset.
+            %   Every cycle of every trial (see getCycleViews) has its
+            %   tables, by default {'IK', 'ID'}, resampled to samples
+            %   points, default 101, i.e. 0 to 100% of the gait cycle. The
+            %   NormalisedCycleStore is assigned to CycleStore and saved in
+            %   the Cache folder, from which it is loaded while no trial
+            %   file is newer than it and the gait event settings (see
+            %   getEventKey) are unchanged. Elements are normalised in
+            %   parallel, reusing their Cycles if the Dataset was loaded as
+            %   CycleViews. The channels of every element are matched to
+            %   those of the first by label, and an element with different
+            %   channels is an error. Cycles which can't be normalised, e.g.
+            %   as the IK doesn't cover their events, are skipped and
+            %   listed in the Skipped table of the store.
+            
+            if nargin < 3
+                samples = 101;
+            end
+            if nargin < 2
+                tables = {'IK', 'ID'};
+            end
+            
+            % Load the store from the cache if possible.
+            n_elements = length(obj.Elements);
+            sources = {};
+            for i=1:n_elements
+                for j=1:length(obj.Elements(i).Trials)
+                    sources = [sources, ...
+                        obj.Elements(i).getTrialFiles(j, tables)]; %#ok<AGROW>
+                end
+            end
+            cache = [obj.DatasetRoot filesep 'Cache' filesep ...
+                'NormalisedCycles.mat'];
+            events = obj.getEventKey();
+            if isUpToDate(cache, sources)
+                cached = load(cache);
+                if isequal(cached.tables, tables) && ...
+                        cached.samples == samples && ...
+                        isfield(cached, 'events') && ...
+                        isequal(cached.events, events)
+                    store = cached.store;
+                    obj.CycleStore = store;
+                    return;
+                end
+            end
+            
+            % Normalise the cycles of each element in parallel.
+            elements = obj.Elements;
+            blocks = cell(n_elements, 1);
+            labels = cell(n_elements, 1);
+            indices = cell(n_elements, 1);
+            skipped = cell(n_elements, 1);
+            parfor i=1:n_elements
+                [blocks{i}, labels{i}, indices{i}, skipped{i}] = ...
+                    elements(i).normaliseCycles(i, tables, samples);
+            end
+            
+            % Combine the elements which have any cycles.
+            found = ~cellfun(@isempty, indices);
+            if ~any(found)
+                error('No gait cycles were found in the Dataset.');
+            end
+            labels = labels(found);
+            blocks = blocks(found);
+            elements = elements(found);
+            for k=2:length(blocks)
+                for i=1:length(tables)
+                    blocks{k}.(tables{i}) = NormalisedCycleStore.align(...
+                        blocks{k}.(tables{i}), labels{k}.(tables{i}), ...
+                        labels{1}.(tables{i}), ...
+                        elements(k).getTraceName());
+                end
+            end
+            store = NormalisedCycleStore(samples, labels{1}, ...
+                blocks, vertcat(indices{found}), vertcat(skipped{:}));
+            obj.CycleStore = store;
+            
+            folder = fileparts(cache);
+            if exist(folder, 'dir') ~= 7
+                mkdir(folder);
+            end
+            save(cache, 'store', 'tables', 'samples', 'events', '-v7.3');
+        end
+        
+        function [cycles, trials] = detectOutliers(obj, threshold, ...
+                tables, samples)
+            % Find outlying cycles and trials, e.g. marker swaps.
+            %   Each element's normalised cycles (see normaliseCycles) are
+            %   streamed once and scored against robust median/MAD
+            %   statistics of that subject and context, see
+            %   robustCycleScores. Cycles scoring above threshold (default
+            %   3) are flagged, and trials where most cycles are flagged.
+            %   Tables default to {'IK', 'ID'} and samples to 101. Returns
+            %   a table of every cycle, with the Channel which scored
+            %   worst, and a table of every trial, both with their Outlier
+            %   flags. Elements are scored in parallel, and only their
+            %   results are gathered.
+            
+            if nargin < 4
+                samples = 101;
+            end
+            if nargin < 3
+                tables = {'IK', 'ID'};
+            end
+            if nargin < 2
+                threshold = 3;
+            end
+            
+            elements = obj.Elements;
+            n_elements = length(elements);
+            cycle_rows = cell(n_elements, 1);
+            trial_rows = cell(n_elements, 1);
+            parfor i=1:n_elements
+                [cycle_rows{i}, trial_rows{i}] = elements(i)...
+                    .detectOutliers(i, tables, samples, threshold);
+            end
+            cycles = vertcat(cycle_rows{:});
+            trials = vertcat(trial_rows{:});
+            
+        end
+        
+        function [index, centres] = clusterCycles(obj, k, method, ...
+                table, labels, varargin)
+            % Group the cycles of the Dataset by their patterns.
+            %   The labelled channels of a table of the CycleStore (see
+            %   buildCycleStore), e.g. IK {'hip_flexion_r', 'knee_angle_r'},
+            %   are scaled to unit variance and laid end to end for each
+            %   cycle, then clustered in to k groups by clusterCycles with
+            %   the given method ('kmeans', 'kmedoids' or 'minibatch') and
+            %   options. Returns the Index of the CycleStore with a Cluster
+            %   column, and the cluster centres. The labels are also written
+            %   to the Clusters property of each element, so that
+            %   Clusters{trial}(cycle) is the cluster of that cycle. This
+            %   is an error if the CycleStore, e.g. loaded from the cache,
+            %   wasn't built from the current Elements.
+            
+            if isempty(obj.CycleStore)
+                error('Build the cycle store before clustering cycles.');
+            end
+            store = obj.CycleStore;
+            obj.assertStoreMatches(store.Index);
+            
+            % Form the features of each cycle.
+            n_cycles = store.getNCycles();
+            features = zeros(n_cycles, store.Samples*length(labels));
+            for i=1:length(labels)
+                values = store.getChannel(table, labels{i});
+                scale = std(values(:));
+                if scale == 0
+                    scale = 1;
+                end
+                features(:, (i - 1)*store.Samples + 1:i*store.Samples) = ...
+                    values/scale;
+            end
+            [clusters, centres] = clusterCycles(features, k, method, ...
+                varargin{:});
+            
+            % Write the labels back to the Index and the elements.
+            index = store.Index;
+            index.Cluster = clusters;
+            for i=1:length(obj.Elements)
+                obj.Elements(i).Clusters = ...
+                    cell(1, length(obj.Elements(i).Trials));
+            end
+            for i=1:n_cycles
+                element = obj.Elements(index.Element(i));
+                element.Clusters{index.Trial(i)}(index.Cycle(i)) = ...
+                    clusters(i);
+            end
+            
+        end
+        
         function assert(obj, analyses)
            
             % Function to run - assertComputed.
@@ -122,6 +489,13 @@ classdef Dataset < handle
         end
         
         function load(obj, analyses)
+            % Load the results of a set of analyses.
+            %   Depending on the Type, each trial is loaded as a Motion,
+            %   Gait or GaitCycle object in the Motions of its element, or
+            %   split in to CycleView objects in its Cycles. CycleViews
+            %   leave Motions empty, so the compute methods, which evaluate
+            %   metrics of Motions, can't be used with them - instead use
+            %   buildCycleStore and the statistics of NormalisedCycleStore.
            
             % Function to run - loading of data.
             func = @loadAnalyses;
@@ -132,10 +506,65 @@ classdef Dataset < handle
         end
         
         
+        function summary = auditResiduals(obj)
+            % Grade the RRA residuals of every trial in the Dataset.
+            %   Returns a table with one row per trial, giving the subject,
+            %   context parameters, trial index, the overall and individual
+            %   residual grades and the worst value of each residual metric.
+            %   Elements are audited in parallel. Per-trial summaries are
+            %   cached alongside the RRA outputs, so re-auditing after a
+            %   partial re-run only analyses the trials which changed.
+            
+            elements = obj.Elements;
+            n_elements = length(elements);
+            rows = cell(n_elements, 1);
+            parfor i=1:n_elements
+                rows{i} = elements(i).auditResiduals();
+            end
+            summary = struct2table(vertcat(rows{:}));
+            
+        end
+        
+        function archiveResults(obj)
+            % Losslessly compress the results of each trial.
+            %   Each trial folder within the results folder of each
+            %   DatasetElement is replaced by its own archive, see
+            %   archiveFolder. Loading reads archived trials without
+            %   extracting them on disk - tables are read straight from the
+            %   archives and anything else from copies extracted to scratch.
+            %   Processing, auditing or asserting the results of an element
+            %   first extracts its archives in place, see
+            %   DatasetElement.unpackResults, so archive the results again
+            %   once done. Elements are archived in parallel.
+            
+            elements = obj.Elements;
+            parfor i=1:length(elements)
+                listing = dir(elements(i).ResultsFolderPath);
+                listing = listing([listing.isdir] & ...
+                    ~ismember({listing.name}, {'.', '..'}));
+                for j=1:length(listing)
+                    archiveFolder([listing(j).folder filesep ...
+                        listing(j).name]);
+                end
+            end
+        end
+        
+        function extractResults(obj)
+            % Restore trial results folders from their archives.
+            %   The inverse of archiveResults. The archives are deleted once
+            %   extracted.
+            
+            elements = obj.Elements;
+            parfor i=1:length(elements)
+                elements(i).unpackResults();
+            end
+        end
+        
         %% Temporary, hard-coded functions 
         function [overall_mean, overall_sdev] = computeObservations(obj, func)
         % Another hard coded function for innovation funding.
         
+            obj.assertMotionsLoaded();
             n_subjects = 1;
             
             overall_obs = zeros(46*n_subjects, 1);
@@ -161,6 +590,7 @@ classdef Dataset < handle
                 computeTrajectories(obj, joint)
         % Another hard coded function for innovation funding.
         
+            obj.assertMotionsLoaded();
             n_subjects = 1;
             
             subject_means = zeros(n_subjects, 100);
@@ -200,6 +630,7 @@ classdef Dataset < handle
         % process some data from the Exoskeleton Gait Metrics dataset. 
         % Obviously this needs to be generalised. 
             
+            obj.assertMotionsLoaded();
             n_subjects = length(obj.Subjects);
             n_assistances = length(obj.ContextParameterRanges{1});
             n_speeds = length(obj.ContextParameterRanges{2});
@@ -246,6 +677,41 @@ classdef Dataset < handle
             path = [obj.getModelFolderPath() filesep obj.HumanModel];
         end
         
+        function folder = createScratchFolder(obj)
+            % Create a uniquely named scratch folder.
+            %   Scratch folders are created in the ScratchFolder, e.g. a
+            %   tmpfs such as /dev/shm, or in the system temporary folder if
+            %   that is empty.
+            root = obj.ScratchFolder;
+            if isempty(root)
+                root = tempdir();
+            end
+            folder = [root filesep 'dram_' ...
+                char(java.util.UUID.randomUUID())];
+            mkdir(folder);
+        end
+        
+        function key = getEventKey(obj)
+            % Settings which the gait events of a trial depend on.
+            %   These are the rotations and cutoffs of the markers and
+            %   GRFs, the FootPlates and the EventThresholds. Caches of
+            %   events, and of anything derived from them, are rebuilt when
+            %   the key changes.
+            key = {obj.MarkerRotation, obj.GRFRotation, obj.MarkerCutoff, ...
+                obj.GRFCutoff, obj.FootPlates, obj.EventThresholds};
+        end
+        
+        function path = getCachePath(obj, path)
+            % Path of the cache of a parsed data file.
+            %   Caches are kept in a Cache folder in the dataset root, in
+            %   the same folder structure as the data, so that they never
+            %   appear in the data folders themselves.
+            [~, name, ext] = fileparts(path);
+            key = obj.getRelativePath(fileparts(path));
+            path = [obj.DatasetRoot filesep 'Cache' filesep ...
+                strrep(key, '/', filesep) filesep name '_' ext(2:end) '.mat'];
+        end
+        
     end
     
     methods (Access = protected)
@@ -266,27 +732,6 @@ classdef Dataset < handle
             values = obj.ModelAdjustmentValues;
        end
        
-       function populate(obj)
-       % Create and store the DatasetElements which populate this Dataset.
-           
-           % Create all possible combinations of the context parameters.
-           params = obj.getDesiredParameterValues();
-           combos = combvec(obj.getDesiredSubjectValues(), params{1, :});
-           n_combinations = size(combos, 2);
-           
-           % Initialise an empty cell array to store the DatasetElements. 
-           elements(n_combinations) = DatasetElement;
-           obj.Elements = elements;
-           
-           % Create each DatasetElement in turn. 
-           for i=1:n_combinations
-               % Create a DatasetElement.
-               obj.Elements(i) = DatasetElement(...
-                   obj, combos(1, i), combos(2:end, i));
-           end
-           
-       end
-        
        function dataLoop(obj, func, inputs, combinations)
            % Loops over data to process or load data.
            %   Loops over DatasetElements performing handle functions and
@@ -338,6 +783,9 @@ classdef Dataset < handle
            % Get the element array in sliceable form.
            elements = obj.Elements(remaining_combinations);
            
+           % Create the trace log, which does nothing if tracing is off.
+           trace = TraceLog(obj.TraceFolder);
+           
            % For every combination of subject and context parameters...
            try
                parfor combination = 1:n_elements
@@ -348,7 +796,10 @@ classdef Dataset < handle
                    element = elements(combination);
                    
                    % Perform the handle functions in turn.
+                   event = trace.start(func2str(func), ...
+                       element.getTraceName(), 0, '', {});
                    feval(func, element, inputs);
+                   trace.finish(event);
                    
                    % Assign back to elements array.
                    elements(combination) = element;
@@ -390,6 +841,107 @@ classdef Dataset < handle
     
     methods (Access = private)
     
+        function assertMotionsLoaded(obj)
+            % Error if the Dataset was loaded without Motions.
+            if strcmp(obj.Type, 'CycleViews')
+                error(['Metrics are computed from Motions, which a ' ...
+                    'CycleViews Dataset doesn''t load. Use ' ...
+                    'buildCycleStore instead.']);
+            end
+        end
+        
+        function assertStoreMatches(obj, index)
+            % Error if a CycleStore Index doesn't match the Elements.
+            %   Each element number of the index must be one of the
+            %   Elements, with the same subject and context parameters,
+            %   and each trial one of its Trials.
+            message = ['The CycleStore doesn''t match the Elements of ' ...
+                'the Dataset. Rebuild it with buildCycleStore.'];
+            if any(index.Element > length(obj.Elements))
+                error(message);
+            end
+            for i=unique(index.Element).'
+                element = obj.Elements(i);
+                rows = index(index.Element == i, :);
+                matches = all(rows.Subject == element.Subject) && ...
+                    all(rows.Trial <= length(element.Trials));
+                for j=1:obj.NContextParameters
+                    matches = matches && all(rows.(...
+                        obj.ContextParameters{j}) == ...
+                        element.ParameterValues(j));
+                end
+                if ~matches
+                    error(message);
+                end
+            end
+        end
+        
+        function runChunkedIK(obj, elements)
+            % Run IK on every trial of the Dataset as chunks in parallel.
+            %   Each trial is split in to chunks of IKChunkFrames frames,
+            %   and the chunks of all trials are solved across the pool
+            %   using pooled IK models, so that a few long trials still use
+            %   every worker. Chunks are solved concurrently, so one can't be
+            %   started from the solution of the previous one. Instead each
+            %   chunk starts IKChunkOverlap frames early, and the overlap is
+            %   discarded when the chunks are merged, by which point the
+            %   solver has settled from its initial pose. Optionally,
+            %   elements gives the indices of the elements to run, e.g. the
+            %   remaining ones when resuming. By default all are run.
+            
+            if ~isfield(obj.ToolSettings, 'IK')
+                error('Chunked IK requires an IK setup file in ToolSettings.');
+            end
+            settings = obj.ToolSettings.IK;
+            if nargin < 2
+                elements = 1:length(obj.Elements);
+            end
+            for i=elements
+                obj.Elements(i).unpackResults();
+            end
+            scratch = obj.createScratchFolder();
+            cleanup = onCleanup(@() rmdir(scratch, 's')); %#ok<NASGU>
+            
+            % Plan the chunks of every trial.
+            n_elements = length(elements);
+            plans = cell(1, n_elements);
+            for i=1:n_elements
+                plans{i} = obj.Elements(elements(i)).planIKChunks(...
+                    obj.IKChunkFrames, obj.IKChunkOverlap, scratch);
+                [plans{i}.Element] = deal(elements(i));
+            end
+            chunks = [plans{:}];
+            
+            % Solve them across the pool.
+            fprintf('Beginning chunked IK.\n');
+            parfor k=1:length(chunks)
+                pool = ToolPool.getPool();
+                pool.runIK(chunks(k).Model, settings, chunks(k).Markers, ...
+                    chunks(k).Output, [chunks(k).Start, chunks(k).Finish]);
+            end
+            
+            % Merge the chunks of each trial.
+            for i=elements
+                obj.Elements(i).mergeIKChunks(...
+                    chunks([chunks.Element] == i), scratch);
+            end
+            fprintf('Chunked IK complete.\n');
+        end
+        
+        function key = getRelativePath(obj, path)
+            % Get the path of a file or folder relative to the DatasetRoot.
+            %   The path is returned with '/' as the separator. Both the
+            %   path and the DatasetRoot are first resolved to absolute
+            %   paths, since listings return absolute folders whether or
+            %   not the DatasetRoot is relative.
+            root = Dataset.getAbsolutePath(obj.DatasetRoot);
+            path = Dataset.getAbsolutePath(path);
+            if ~strncmp(path, [root filesep], length(root) + 1)
+                error('%s is not within the Dataset.', path);
+            end
+            key = strrep(path(length(root) + 2:end), filesep, '/');
+        end
+        
         function parseDatasetDescriptor(obj)
             % Parse the DatasetDescriptor file and assign properties.
             xml_data = xmlread([obj.DatasetRoot filesep ...
@@ -431,6 +983,12 @@ classdef Dataset < handle
                 str2double(strtrim(char(xml_data.getElementsByTagName(...
                 'Delay').item(0).item(0).getData())));
             
+            % Get the optional filter cutoffs.
+            obj.MarkerCutoff = Dataset.parseOptionalNumber(...
+                xml_data, 'MarkerCutoff');
+            obj.GRFCutoff = Dataset.parseOptionalNumber(...
+                xml_data, 'GRFCutoff');
+            
             % Get the marker co-ordinate system information.
             markers = xml_data.getElementsByTagName('Markers');
             obj.MarkerSystem.Forward = strtrim( ...
@@ -455,6 +1013,10 @@ classdef Dataset < handle
                 char(grfs.item(0).getElementsByTagName('Right'). ...
                 item(0).item(0).getData()));
             
+            % Compile the co-ordinate systems to rotation matrices.
+            obj.MarkerRotation = Dataset.compileAxes(obj.MarkerSystem);
+            obj.GRFRotation = Dataset.compileAxes(obj.GRFSystem);
+            
             % Get the subject vector. 
             subjects = xml_data.getElementsByTagName('Subjects');
             obj.Subjects = str2num(strtrim(char(subjects.item(0). ...
@@ -551,6 +1113,63 @@ classdef Dataset < handle
         end
     end
     
+    methods (Static, Access = private)
+        
+        function path = getAbsolutePath(path)
+            % Resolve a path against the working directory and remove any
+            % '.' and '..' parts and trailing separator.
+            file = java.io.File(path);
+            if ~file.isAbsolute()
+                file = java.io.File(pwd, path);
+            end
+            path = char(file.getCanonicalPath());
+        end
+        
+        function value = parseOptionalNumber(xml_data, tag)
+            % Parse a number from a DatasetDescriptor tag.
+            %   Returns an empty array if the tag isn't present.
+            nodes = xml_data.getElementsByTagName(tag);
+            if nodes.getLength() == 0
+                value = [];
+            else
+                value = str2double(strtrim(char(...
+                    nodes.item(0).item(0).getData())));
+            end
+        end
+        
+        function rotation = compileAxes(system)
+            % Compile a co-ordinate system to a rotation matrix.
+            %   The system gives the lab axis, e.g. '+z' or '-x', which
+            %   points forwards, upwards and to the right. The returned
+            %   matrix rotates lab vectors in to the OpenSim frame, in which
+            %   x points forwards, y upwards and z to the right. Systems
+            %   which are left handed, i.e. would need a reflection rather
+            %   than a rotation, are rejected, as they would flip the sign
+            %   of moments and torques.
+            
+            directions = {system.Forward, system.Up, system.Right};
+            rotation = zeros(3);
+            for i=1:3
+                direction = lower(directions{i});
+                axis = find('xyz' == direction(end));
+                if isempty(axis) || length(direction) > 2 || ...
+                        (length(direction) == 2 && ~any(direction(1) == '+-'))
+                    error('Co-ordinate axis %s not recognised.', ...
+                        directions{i});
+                end
+                rotation(i, axis) = 1 - 2*(direction(1) == '-');
+            end
+            if any(sum(abs(rotation), 1) ~= 1)
+                error('Co-ordinate systems must use each axis once.');
+            end
+            if det(rotation) ~= 1
+                error('Co-ordinate system %s, %s, %s is not right handed.', ...
+                    directions{:});
+            end
+        end
+        
+    end
+    
     methods (Static)
         
         function resume(filename)
@@ -19,6 +19,9 @@ classdef DatasetElement < handle
         Processed = false
         Trials
         Motions
+        Events
+        Cycles
+        Clusters
     end
 
     properties %(Access = ?Dataset)
@@ -35,6 +38,16 @@ classdef DatasetElement < handle
         AdjustedModelPath
     end
     
+    properties (Access = private)
+        TrialInputs % Listing of the marker and force files, or empty.
+    end
+    
+    properties (Constant, Access = private)
+        % Earlier analyses whose results each analysis reads.
+        AnalysisInputs = struct('IK', {{}}, 'RRA', {{'IK'}}, ...
+            'BK', {{'IK'}}, 'ID', {{'IK'}}, 'SO', {{'IK'}}, 'CMC', {{'IK'}})
+    end
+    
     methods (Access = ?Dataset)
 
         function obj = DatasetElement(dataset, subject, parameters)
@@ -81,45 +94,232 @@ classdef DatasetElement < handle
             % Create OpenSimTrial objects based on DatasetElement
             % parameters.
             
-            if obj.ParentDataset.ModelAdjustmentCompleted
-                model = obj.AdjustedModelPath;
-            else
-                model = obj.ModelPath;
-            end
-            
-            obj.Trials = createTrials(model, obj.MotionFolderPath, ...
-                obj.ResultsFolderPath, obj.ForcesFolderPath);
+            obj.Trials = obj.constructTrials(obj.ResultsFolderPath);
+            obj.TrialInputs = [];
             
         end
         
         function assertComputed(obj, analyses)
             % Assert that the provided analyses have been computed.
             
+            obj.unpackResults();
             for i=1:length(obj.Trials)
                 obj.Trials{i}.assertComputed(analyses);
             end
             
         end
         
-        function runAnalyses(obj, analyses)
+        function runAnalyses(obj, analyses, indices)
             % Runs batch of OpenSim analyses on the input data.
+            %   The analyses are run in a scratch folder private to this
+            %   call, which is also the working directory while they run, so
+            %   that setup files, logs and intermediate outputs of parallel
+            %   runs never collide. The existing results of the earlier
+            %   analyses which the requested ones read, e.g. IK for ID, are
+            %   copied in first. Only the outputs of the analyses which were
+            %   run are then committed to the ResultsFolderPath, each
+            %   analysis folder replaced atomically. Optionally, indices
+            %   selects the trials to run, by default all of them. The
+            %   element is only marked processed when every trial is run.
+            %   Archived trial results are first extracted, see
+            %   unpackResults.
+            
+            obj.unpackResults();
+            if nargin < 3
+                indices = 1:length(obj.Trials);
+            end
+            
+            % Create the scratch folder and trials which write to it.
+            scratch = obj.ParentDataset.createScratchFolder();
+            previous = cd(scratch);
+            cleanup = onCleanup(@() DatasetElement.removeScratchFolder(...
+                scratch, previous)); %#ok<NASGU>
+            results = [scratch filesep 'Results'];
+            obj.copyAnalysisInputs(results, analyses, indices);
+            trials = obj.constructTrials(results);
+            for i=indices
+                trials{i} = obj.getFrameTrial(i, ...
+                    fileparts(trials{i}.results_paths.IK));
+            end
             
-            runBatch(analyses, obj.Trials, 'load', obj.constructLoadPath());
+            % Read the inputs of upcoming trials while others run.
+            prefetcher = Prefetcher(obj.ParentDataset.PrefetchDepth);
             
-            obj.Processed = true;
+            % Tracing records the run as it happens, one event for the
+            % whole batch or one per pooled trial and analysis.
+            trace = TraceLog(obj.ParentDataset.TraceFolder);
+            pooled = ~isempty(fieldnames(obj.ParentDataset.ToolSettings));
+            if ~pooled
+                % The batch reads the trials in one call, so only the first
+                % few can be warmed ahead of it.
+                obj.prefetchTrials(prefetcher, indices, ...
+                    @(index) obj.getRunFiles(index));
+                n_trials = length(indices);
+                inputs = cell(1, n_trials);
+                outputs = cell(length(analyses), n_trials);
+                for i=1:n_trials
+                    inputs{i} = obj.getTrialInputs(indices(i));
+                    for j=1:length(analyses)
+                        outputs{j, i} = trials{indices(i)}...
+                            .results_paths.(analyses{j});
+                    end
+                end
+                event = trace.start('run', obj.getTraceName(), 0, ...
+                    strjoin(analyses, '+'), [inputs{:}]);
+                runBatch(analyses, trials(indices), ...
+                    'load', obj.constructLoadPath());
+                trace.finish(event, outputs(:).');
+            else
+                % Run each analysis of each trial separately, so that each
+                % can use a pooled model.
+                for k=1:length(indices)
+                    i = indices(k);
+                    obj.prefetchTrials(prefetcher, indices(k:end), ...
+                        @(index) obj.getRunFiles(index));
+                    for j=1:length(analyses)
+                        event = trace.start('run', obj.getTraceName(), ...
+                            i, analyses{j}, obj.getTrialInputs(i));
+                        obj.runTrialAnalysis(analyses{j}, trials, i);
+                        trace.finish(event, ...
+                            {trials{i}.results_paths.(analyses{j})});
+                    end
+                end
+            end
+            
+            % Commit the outputs of the analyses which were run.
+            for i=indices
+                for j=1:length(analyses)
+                    commitFolder(trials{i}.results_paths.(analyses{j}), ...
+                        obj.Trials{i}.results_paths.(analyses{j}));
+                end
+            end
+            obj.createTrials();
+            
+            if isequal(sort(indices), 1:length(obj.Trials))
+                obj.Processed = true;
+            end
+        end
+        
+        function grade = runMonitoredTrial(obj, analyses, index, window)
+            % Runs OpenSim analyses on a single trial, monitoring RRA.
+            %   Before RRA is run, it is tried by runChunkedRRA in chunks
+            %   of window seconds whose residuals are graded as each chunk
+            %   completes. If they are bad, the run is abandoned, no
+            %   further analyses are run and 'bad' is returned. Otherwise
+            %   a full RRA is run and committed as by process, and the
+            %   grade of its residuals is returned, stopping there if it
+            %   is bad. The grade is 'unknown' if RRA was not among the
+            %   analyses. Every analysis is run by runAnalyses, in its own
+            %   scratch folder, with those between RRAs run together.
+            
+            grade = 'unknown';
+            first = 1;
+            for i=1:length(analyses) + 1
+                if i <= length(analyses) && ~strcmp(analyses{i}, 'RRA')
+                    continue;
+                end
+                if i > first
+                    obj.runAnalyses(analyses(first:i - 1), index);
+                end
+                first = i + 1;
+                if i > length(analyses)
+                    break;
+                end
+                grade = obj.runChunkedRRA(index, window);
+                if strcmp(grade, 'bad')
+                    return;
+                end
+                obj.runAnalyses({'RRA'}, index);
+                summary = obj.getResidualSummary(index);
+                grade = summary.Grade;
+                if strcmp(grade, 'bad')
+                    return;
+                end
+            end
+        end
+        
+        function grade = runChunkedRRA(obj, index, window)
+            % Try the RRA of a trial as consecutive chunks of time.
+            %   OpenSim only writes the RRA outputs at the end of a run, so
+            %   to monitor a run it is split in to chunks of window seconds,
+            %   each solved by runRRA in a scratch folder and checked by an
+            %   RRAMonitor as soon as it finishes. RRA starts each run from
+            %   the desired kinematics, and its residuals take a while to
+            %   settle, so every chunk but the first starts RRALeadIn
+            %   seconds early and only its residuals from its own start
+            %   time are checked. The transient at the start of the first
+            %   chunk is that of a full run. Returns 'bad' as soon as a
+            %   MAX metric is bad, without running the remaining chunks,
+            %   and 'unknown' otherwise. The chunks are only used for
+            %   monitoring and are discarded, so nothing is written to the
+            %   results of the trial.
+            
+            scratch = obj.ParentDataset.createScratchFolder();
+            cleanup = onCleanup(@() rmdir(scratch, 's')); %#ok<NASGU>
+            kinematics = [obj.Trials{index}.results_paths.IK filesep 'ik.mot'];
+            values = readOpenSimTable(kinematics);
+            edges = unique([values(1, 1):window:values(end, 1), ...
+                values(end, 1)]);
+            lead = obj.ParentDataset.RRALeadIn;
+            
+            % Run the chunks in turn, stopping as soon as RRA goes bad.
+            grade = 'unknown';
+            monitor = RRAMonitor();
+            for k=1:length(edges) - 1
+                folder = [scratch filesep sprintf('Chunk%d', k)];
+                prefix = obj.runRRA(index, kinematics, folder, ...
+                    [max(edges(1), edges(k) - lead), edges(k + 1)]);
+                grade = monitor.check(prefix, edges(k));
+                if strcmp(grade, 'bad')
+                    return;
+                end
+            end
+        end
+        
+        function folder = getRRAFolder(obj, index)
+            % Get the folder which the RRA outputs of a trial are written to.
+            folder = obj.Trials{index}.results_paths.RRA;
         end
         
         function loadAnalyses(obj, analyses)
             
+            % Archived trials are read from copies extracted to a scratch
+            % folder, so that loading leaves them archived.
+            if ~isempty(dir([obj.ResultsFolderPath filesep '*.h5']))
+                scratch = obj.ParentDataset.createScratchFolder();
+                cleanup = onCleanup(@() rmdir(scratch, 's')); %#ok<NASGU>
+            else
+                scratch = [];
+            end
             n_trials = length(obj.Trials);
             obj.Motions = cell(1, n_trials);
+            obj.Cycles = cell(1, n_trials);
+            % Only CycleViews are split using the event index. Gait and
+            % GaitCycle objects find their cycles from the MotionData.
+            if strcmp(obj.ParentDataset.Type, 'CycleViews')
+                obj.indexGaitEvents();
+            end
+            trace = TraceLog(obj.ParentDataset.TraceFolder);
+            prefetcher = Prefetcher(obj.ParentDataset.PrefetchDepth);
             
             for i=1:n_trials
+                obj.prefetchTrials(prefetcher, i:n_trials, ...
+                    @(index) obj.getLoadFiles(index, analyses));
+                event = trace.start('load', obj.getTraceName(), i, ...
+                    strjoin(analyses, '+'), obj.getTrialInputs(i));
+                if strcmp(obj.ParentDataset.Type, 'CycleViews')
+                    obj.Cycles{i} = obj.getCycleViews(i, analyses);
+                    trace.finish(event);
+                    continue;
+                end
+                % Read the inputs in the OpenSim frame and already filtered
+                % at the Dataset cutoffs, see getLoadTrial, so MotionData
+                % is given no cutoff of its own.
                 subject_index = find(obj.ParentDataset.Subjects == obj.Subject);
-                motion_data = MotionData(obj.Trials{i}, ...
+                motion_data = MotionData(obj.getLoadTrial(i, scratch), ...
                     obj.ParentDataset.LegLengths(subject_index), ...
                     obj.ParentDataset.ToeLengths(subject_index), ...
-                    analyses, obj.ParentDataset.GRFCutoff);
+                    analyses, []);
                 switch obj.ParentDataset.Type
                     case 'Motion'
                         obj.Motions{i} = Motion(motion_data);
@@ -128,10 +328,516 @@ classdef DatasetElement < handle
                     case 'GaitCycles'
                         obj.Motions{i} = GaitCycle(motion_data);
                 end
+                trace.finish(event);
             end
                 
         end
         
+        function unpackResults(obj)
+            % Extract any archived trial results folders in place.
+            %   Trials archived by the archiveResults method of Dataset are
+            %   restored to their folders and their archives removed, see
+            %   extractArchive, and the trials are then recreated. This is
+            %   done before anything runs on, writes to or checks the
+            %   results of the trials, all of which need them on disk.
+            listing = dir([obj.ResultsFolderPath filesep '*.h5']);
+            for i=1:length(listing)
+                extractArchive([listing(i).folder filesep ...
+                    listing(i).name], true);
+            end
+            if ~isempty(listing)
+                obj.createTrials();
+            end
+        end
+        
+        function name = getTraceName(obj)
+            % Name of this element in trace logs, e.g. Subject1/Speed2.
+            name = obj.constructSubjectFolderName();
+            for i=1:obj.ParentDataset.NContextParameters
+                name = [name '/' obj.ParentDataset.ContextParameters{i} ...
+                    num2str(obj.ParameterValues(i))];
+            end
+        end
+        
+        function inputs = getTrialInputs(obj, index)
+            % Paths to the marker and force files of a trial.
+            %   The input folders are listed once and the listing kept
+            %   until the trials are next created.
+            if isempty(obj.TrialInputs)
+                [~, markers] = dirNoDots(obj.MotionFolderPath);
+                [~, forces] = dirNoDots(obj.ForcesFolderPath);
+                obj.TrialInputs = {markers, forces};
+            end
+            inputs = {obj.TrialInputs{1}{index}, obj.TrialInputs{2}{index}};
+        end
+        
+        function runLoadVariants(obj, values)
+            % Run batched ID on each trial under the load sets of several
+            % model parameter values.
+            %   The results are written in to a copy of each trial's ID
+            %   folder in a scratch folder, which then replaces the ID
+            %   folder atomically, see commitFolder.
+            
+            settings = obj.ParentDataset.ToolSettings;
+            if ~isfield(settings, 'ID')
+                error('Batched ID requires an ID setup file in ToolSettings.');
+            end
+            obj.unpackResults();
+            
+            % Get the distinct load sets of the given values.
+            loads = cell(1, length(values));
+            for i=1:length(values)
+                loads{i} = obj.ParentDataset.LoadMap(values(i));
+            end
+            loads = unique(loads, 'stable');
+            paths = strcat(obj.ParentDataset.getModelFolderPath(), ...
+                filesep, loads);
+            scratch = obj.ParentDataset.createScratchFolder();
+            cleanup = onCleanup(@() rmdir(scratch, 's')); %#ok<NASGU>
+            for i=1:length(obj.Trials)
+                inputs = obj.getFrameInputs(i);
+                output = obj.Trials{i}.results_paths.ID;
+                staged= [scratch filesep 'ID' num2str(i)];
+                if exist(output, 'dir') == 7
+                    copyfile(output, staged);
+                else
+                    mkdir(staged);
+                end
+                outputs = cell(1, length(loads));
+                for j=1:length(loads)
+                    [~, name] = fileparts(loads{j});
+                    outputs{j} = [staged filesep 'id_' name '.sto'];
+                end
+                runBatchedID(obj.getModel(), ...
+                    [obj.Trials{i}.results_paths.IK filesep 'ik.mot'], ...
+                    paths, repmat(inputs(2), 1, length(loads)), outputs, ...
+                    settings.ID);
+                commitFolder(staged, output);
+            end
+        end
+        
+        function [values, labels, header] = loadMarkers(obj, index)
+            % Load the markers of a trial, in the OpenSim frame.
+            %   Marker triplets are rotated by the MarkerRotation of the
+            %   parent Dataset, filtered at its MarkerCutoff, and the result
+            %   is cached, see readCachedTable.
+            inputs = obj.getTrialInputs(index);
+            [values, labels, header] = readCachedTable(inputs{1}, ...
+                obj.ParentDataset.getCachePath(inputs{1}), ...
+                obj.ParentDataset.MarkerRotation, ...
+                obj.ParentDataset.MarkerCutoff);
+        end
+        
+        function [values, labels, header] = loadForces(obj, index)
+            % Load the forces of a trial, in the OpenSim frame.
+            %   Force, centre of pressure and torque triplets are rotated by
+            %   the GRFRotation of the parent Dataset, filtered at its
+            %   GRFCutoff, and the result is cached, see readCachedTable.
+            inputs = obj.getTrialInputs(index);
+            [values, labels, header] = readCachedTable(inputs{2}, ...
+                obj.ParentDataset.getCachePath(inputs{2}), ...
+                obj.ParentDataset.GRFRotation, ...
+                obj.ParentDataset.GRFCutoff);
+        end
+        
+        function trial = getLoadTrial(obj, index, scratch)
+            % Get a trial which reads the inputs in the OpenSim frame.
+            %   As getFrameTrial, with the results folder of the trial
+            %   itself or, if the trial has been archived, a copy extracted
+            %   within scratch.
+            results = fileparts(obj.Trials{index}.results_paths.IK);
+            if exist(results, 'dir') ~= 7 && ...
+                    exist([results '.h5'], 'file') == 2
+                [~, name] = fileparts(results);
+                extractArchive([results '.h5'], false, ...
+                    [scratch filesep name]);
+                results = [scratch filesep name];
+            end
+            trial = obj.getFrameTrial(index, results);
+        end
+        
+        function trial = getFrameTrial(obj, index, results)
+            % Get a trial which reads the inputs in the OpenSim frame and
+            % writes to a results folder.
+            %   The trial reads the files of getFrameInputs, so analyses run
+            %   on it and the markers and forces loaded with its results
+            %   share one frame.
+            inputs = obj.getFrameInputs(index);
+            trial = OpenSimTrial(obj.getModel(), inputs{1}, results, ...
+                inputs{2});
+        end
+        
+        function inputs = getFrameInputs(obj, index)
+            % Paths to the marker and force files of a trial in the OpenSim
+            % frame.
+            %   If the parent Dataset rotates or filters an input, this is
+            %   the table returned by loadMarkers or loadForces written next
+            %   to its cache, as a .trc or .mot file, which is rewritten
+            %   whenever the cache is. Otherwise it is the input itself.
+            %   Every analysis reads these files, so that all the results
+            %   of a trial share the frame of its loaded markers and forces.
+            inputs = obj.getTrialInputs(index);
+            dataset = obj.ParentDataset;
+            if ~isequal(dataset.MarkerRotation, eye(3)) || ...
+                    ~isempty(dataset.MarkerCutoff)
+                [values, labels, header] = obj.loadMarkers(index);
+                inputs{1} = obj.writeLoadFile(inputs{1}, values, labels, ...
+                    header);
+            end
+            if ~isequal(dataset.GRFRotation, eye(3)) || ...
+                    ~isempty(dataset.GRFCutoff)
+                [values, labels, header] = obj.loadForces(index);
+                inputs{2} = obj.writeLoadFile(inputs{2}, values, labels, ...
+                    header);
+            end
+        end
+        
+        function path = getLoadFilePath(obj, input)
+            % Path of the file written from the cache of an input table.
+            [~, ~, ext] = fileparts(input);
+            cache = obj.ParentDataset.getCachePath(input);
+            path = [cache(1:end - length('.mat')) ext];
+        end
+        
+        function path = writeLoadFile(obj, input, values, labels, header)
+            % Write a loaded input table next to its cache, if needed.
+            path = obj.getLoadFilePath(input);
+            if ~isUpToDate(path, {obj.ParentDataset.getCachePath(input)})
+                writeOpenSimTable(path, values, labels, header);
+            end
+        end
+        
+        function events = getGaitEvents(obj, index)
+            % Get the gait events of a trial from its event index.
+            %   Events are detected by detectGaitEvents from the forces and
+            %   markers in the OpenSim frame, using the FootPlates and
+            %   EventThresholds of the parent Dataset, and saved alongside
+            %   the cached markers. The index is only rebuilt when the
+            %   marker or force file changes, or any of the rotations,
+            %   cutoffs, foot plates or thresholds it was made with.
+            dataset = obj.ParentDataset;
+            key = dataset.getEventKey();
+            inputs = obj.getTrialInputs(index);
+            cache = strrep(dataset.getCachePath(inputs{1}), ...
+                '.mat', '_events.mat');
+            if isUpToDate(cache, inputs)
+                cached = load(cache);
+                if isfield(cached, 'key') && isequal(cached.key, key)
+                    events = cached.events;
+                    return;
+                end
+            end
+            [forces, force_labels] = obj.loadForces(index);
+            [markers, marker_labels] = obj.loadMarkers(index);
+            events = detectGaitEvents(forces, force_labels, markers, ...
+                marker_labels, dataset.EventThresholds, dataset.FootPlates);
+            save(cache, 'events', 'key');
+        end
+        
+        function indexGaitEvents(obj, ~)
+            % Fill the Events property with the gait events of each trial.
+            n_trials = length(obj.Trials);
+            obj.Events = cell(1, n_trials);
+            for i=1:n_trials
+                obj.Events{i} = obj.getGaitEvents(i);
+            end
+        end
+        
+        function store = loadTrialStore(obj, index, analyses)
+            % Load the tables of a trial in to a TrialStore.
+            %   The store holds the markers and forces, in the OpenSim
+            %   frame, and the IK and ID results if these are among the
+            %   analyses.
+            store = TrialStore();
+            [values, labels] = obj.loadMarkers(index);
+            store.add('Markers', values, labels);
+            [values, labels] = obj.loadForces(index);
+            store.add('Forces', values, labels);
+            files = struct('IK', 'ik.mot', 'ID', 'id.sto');
+            for i=1:length(analyses)
+                if isfield(files, analyses{i})
+                    [values, labels] = readOpenSimTable([obj.Trials{index}...
+                        .results_paths.(analyses{i}) filesep ...
+                        files.(analyses{i})]);
+                    store.add(analyses{i}, values, labels);
+                end
+            end
+        end
+        
+        function cycles = getCycleViews(obj, index, analyses)
+            % Split a trial in to CycleViews of its TrialStore.
+            %   There is one cycle between each pair of consecutive heel
+            %   strikes of each foot, as given by the event index. Cycles
+            %   are ordered by start time. The events are taken from the
+            %   Events property if indexed, and from the cache otherwise.
+            store = obj.loadTrialStore(index, analyses);
+            if length(obj.Events) >= index && ~isempty(obj.Events{index})
+                events = obj.Events{index};
+            else
+                events = obj.getGaitEvents(index);
+            end
+            cycles = CycleView.empty();
+            sides = {'Right', 'Left'};
+            for side=1:length(sides)
+                strikes = events.(sides{side}).HeelStrike;
+                for j=1:length(strikes) - 1
+                    cycles(end + 1) = CycleView(store, ...
+                        strikes([j, j + 1]), sides{side}); %#ok<AGROW>
+                end
+            end
+            if ~isempty(cycles)
+                [~, order] = sort(arrayfun(@(x) x.Range(1), cycles));
+                cycles = cycles(order);
+            end
+        end
+        
+        function [values, labels, index, skipped] = ...
+                normaliseCycles(obj, number, tables, samples)
+            % Time-normalise the cycles of every trial of this element.
+            %   Returns a struct of cycles x samples x channels arrays of
+            %   each table, their labels, and a table indexing each cycle by
+            %   element number, trial, cycle, subject, side and context
+            %   parameter values. The cycles of each trial are its Cycles
+            %   if loaded, or otherwise are created and released in turn,
+            %   split at the events of the event index, which is read for
+            %   every trial first if it hasn't been already (see
+            %   indexGaitEvents). The channels of each trial are matched to
+            %   those of the first trial with any cycles by label, and a
+            %   trial with different channels is an error. Cycles which
+            %   can't be normalised (see NormalisedCycleStore.normalise)
+            %   are left out, and listed in the same way in skipped, with a
+            %   warning.
+            n_trials = length(obj.Trials);
+            if length(obj.Events) < n_trials
+                obj.indexGaitEvents();
+            end
+            blocks = cell(n_trials, 1);
+            rows = cell(n_trials, 1);
+            skipped_rows = cell(n_trials, 1);
+            labels = [];
+            for i=1:n_trials
+                if length(obj.Cycles) >= i && ~isempty(obj.Cycles{i})
+                    cycles = obj.Cycles{i};
+                else
+                    cycles = obj.getCycleViews(i, tables);
+                end
+                n_cycles = length(cycles);
+                [blocks{i}, trial_labels, valid] = ...
+                    NormalisedCycleStore.normalise(cycles, tables, samples);
+                if isempty(labels) && any(valid)
+                    labels = trial_labels;
+                elseif any(valid)
+                    for j=1:length(tables)
+                        blocks{i}.(tables{j}) = NormalisedCycleStore.align(...
+                            blocks{i}.(tables{j}), trial_labels.(tables{j}), ...
+                            labels.(tables{j}), sprintf('trial %d of %s', ...
+                            i, obj.getTraceName()));
+                    end
+                end
+                rows{i} = table(repmat(number, n_cycles, 1), ...
+                    repmat(i, n_cycles, 1), (1:n_cycles).', ...
+                    repmat(obj.Subject, n_cycles, 1), ...
+                    reshape({cycles.Side}, [], 1), ...
+                    'VariableNames', ...
+                    {'Element', 'Trial', 'Cycle', 'Subject', 'Side'});
+                for j=1:obj.ParentDataset.NContextParameters
+                    rows{i}.(obj.ParentDataset.ContextParameters{j}) = ...
+                        repmat(obj.ParameterValues(j), n_cycles, 1);
+                end
+                skipped_rows{i} = rows{i}(~valid, :);
+                rows{i} = rows{i}(valid, :);
+                if ~all(valid)
+                    warning(['Skipped %d of the %d cycles of trial %d ' ...
+                        'of %s, which have too few frames.'], ...
+                        nnz(~valid), n_cycles, i, obj.getTraceName());
+                end
+            end
+            index = vertcat(rows{:});
+            skipped = vertcat(skipped_rows{:});
+            values = struct();
+            for i=1:length(tables)
+                parts = cellfun(@(x) x.(tables{i}), blocks, ...
+                    'UniformOutput', false);
+                values.(tables{i}) = cat(1, parts{~cellfun(@isempty, parts)});
+            end
+        end
+        
+        function [cycles, trials] = detectOutliers(obj, number, tables, ...
+                samples, threshold)
+            % Flag the cycles and trials of this element which are outliers.
+            %   The normalised cycles of every trial are scored together by
+            %   robustCycleScores, and cycles scoring above threshold are
+            %   flagged. A trial is flagged if most of its cycles are.
+            %   Returns a table with one row per cycle, as indexed by
+            %   normaliseCycles with its Score, the Channel which scored
+            %   worst and its Outlier flag, and a table with one row per
+            %   trial. Only this element's cycles are held in memory.
+            
+            [values, labels, cycles] = obj.normaliseCycles(number, ...
+                tables, samples);
+            [scores, channels] = robustCycleScores(values, labels);
+            cycles.Score = scores;
+            cycles.Channel = channels;
+            cycles.Outlier = cycles.Score > threshold;
+            
+            n_trials = length(obj.Trials);
+            rows = [];
+            for i=1:n_trials
+                row.Element = number;
+                row.Subject = obj.Subject;
+                for j=1:obj.ParentDataset.NContextParameters
+                    row.(obj.ParentDataset.ContextParameters{j}) = ...
+                        obj.ParameterValues(j);
+                end
+                row.Trial = i;
+                trial = cycles.Trial == i;
+                row.NCycles = nnz(trial);
+                row.NOutliers = nnz(cycles.Outlier(trial));
+                row.MedianScore = median(cycles.Score(trial));
+                row.Outlier = row.NOutliers > row.NCycles/2;
+                rows = [rows; row]; %#ok<AGROW>
+            end
+            trials = struct2table(rows, 'AsArray', true);
+        end
+        
+        function files = getTrialFiles(obj, index, analyses)
+            % Paths to the files used by a trial for a set of analyses.
+            %   These are the marker, force and model files, and the files
+            %   in the results folders of any of the analyses.
+            files = [obj.getRunFiles(index), ...
+                obj.getResultsFiles(index, analyses)];
+        end
+        
+        function files = getRunFiles(obj, index)
+            % Paths to the files read from the Dataset when running
+            % analyses on a trial, i.e. the marker, force and model files.
+            %   Earlier results are read from their copies in the scratch
+            %   folder of runAnalyses.
+            files = [obj.getTrialInputs(index), {obj.getModel()}];
+        end
+        
+        function files = getLoadFiles(obj, index, analyses)
+            % Paths to the files read when loading a trial.
+            %   These are the caches of the markers and forces, the files
+            %   written from them by getLoadTrial and the files in the
+            %   results folders of any of the analyses.
+            inputs = obj.getTrialInputs(index);
+            files = {};
+            for i=1:length(inputs)
+                files = [files, ...
+                    {obj.ParentDataset.getCachePath(inputs{i}), ...
+                    obj.getLoadFilePath(inputs{i})}];
+            end
+            files = [files, obj.getResultsFiles(index, analyses)];
+        end
+        
+        function files = getResultsFiles(obj, index, analyses)
+            % Paths to the files in the results folders of any of a set of
+            % analyses of a trial.
+            %   If the trial has been archived this is its archive.
+            paths = obj.Trials{index}.results_paths;
+            folder = fileparts(paths.IK);
+            if exist(folder, 'dir') ~= 7 && ...
+                    exist([folder '.h5'], 'file') == 2
+                files = {[folder '.h5']};
+                return;
+            end
+            files = {};
+            for i=1:length(analyses)
+                if isfield(paths, analyses{i})
+                    listing = dir(paths.(analyses{i}));
+                    listing = listing(~[listing.isdir]);
+                    files = [files, strcat({listing.folder}, filesep, ...
+                        {listing.name})];
+                end
+            end
+        end
+        
+        function chunks = planIKChunks(obj, frames, overlap, scratch)
+            % Split the IK of each trial in to chunks of frames frames.
+            %   Returns a struct array giving the trial, marker file and
+            %   model of each chunk, the times to solve it between - which
+            %   start overlap frames early - the time from which its
+            %   solution is kept, and a folder within scratch for its
+            %   output.
+            
+            chunks = [];
+            model = obj.getModel();
+            for i=1:length(obj.Trials)
+                inputs = obj.getFrameInputs(i);
+                values = readOpenSimTable(inputs{1});
+                times = values(:, 2);
+                for first=1:frames:length(times)
+                    chunk.Trial = i;
+                    chunk.Markers = inputs{1};
+                    chunk.Model = model;
+                    chunk.Start = times(max(1, first - overlap));
+                    chunk.Finish = times(min(first + frames - 1, ...
+                        length(times)));
+                    chunk.Keep = times(first);
+                    chunk.Output = [scratch filesep ...
+                        char(java.util.UUID.randomUUID())];
+                    chunks = [chunks, chunk];
+                end
+            end
+        end
+        
+        function mergeIKChunks(obj, chunks, scratch)
+            % Merge the IK outputs of chunks in to one set per trial.
+            %   Each .sto/.mot output of the first chunk of a trial, i.e.
+            %   ik.mot and any marker errors and marker locations, is
+            %   merged with those of the other chunks, each chunk
+            %   contributing the frames from its Keep time up to the Keep
+            %   time of the next. The merged outputs are written to a folder
+            %   within scratch which is then committed to the trial's IK
+            %   results folder.
+            
+            for i=unique([chunks.Trial])
+                trial_chunks = chunks([chunks.Trial] == i);
+                [~, order] = sort([trial_chunks.Keep]);
+                trial_chunks = trial_chunks(order);
+                merged = [scratch filesep char(java.util.UUID.randomUUID())];
+                mkdir(merged);
+                listing = dir(trial_chunks(1).Output);
+                [~, ~, ext] = cellfun(@fileparts, {listing.name}, ...
+                    'UniformOutput', false);
+                names = {listing(ismember(lower(ext), ...
+                    {'.sto', '.mot'})).name};
+                for j=1:length(names)
+                    paths = strcat({trial_chunks.Output}, filesep, names{j});
+                    mergeOpenSimTables(paths, ...
+                        [merged filesep names{j}], [trial_chunks.Keep]);
+                end
+                commitFolder(merged, obj.Trials{i}.results_paths.IK);
+            end
+        end
+        
+        function rows = auditResiduals(obj)
+            % Summarise the RRA residuals of each trial.
+            %   Returns a struct array with one row per trial, giving the
+            %   subject, context parameters, trial index, residual grades and
+            %   the worst value of each residual metric.
+            
+            obj.unpackResults();
+            n_trials = length(obj.Trials);
+            rows = [];
+            for i=1:n_trials
+                row.Subject = obj.Subject;
+                for j=1:obj.ParentDataset.NContextParameters
+                    row.(obj.ParentDataset.ContextParameters{j}) = ...
+                        obj.ParameterValues(j);
+                end
+                row.Trial = i;
+                summary = obj.getResidualSummary(i);
+                names = fieldnames(summary);
+                for j=1:length(names)
+                    row.(names{j}) = summary.(names{j});
+                end
+                rows = [rows; row];
+            end
+            
+        end
+        
         function observations = computeMetric(obj, metric, args)
            
             n_motions = length(obj.Motions);
@@ -146,6 +852,142 @@ classdef DatasetElement < handle
         
     methods (Access = private)
         
+        function model = getModel(obj)
+            % Get the path to the model to use for analyses.
+            if obj.ParentDataset.ModelAdjustmentCompleted
+                model = obj.AdjustedModelPath;
+            else
+                model = obj.ModelPath;
+            end
+        end
+        
+        function prefetchTrials(~, prefetcher, indices, files)
+            % Warm the files of the first Depth of a vector of trials.
+            %   Indices are the trials still to be run or loaded, in order,
+            %   and files a function giving the files of a trial index,
+            %   e.g. getRunFiles. Files already being warmed are skipped.
+            for i=indices(1:min(prefetcher.Depth, end))
+                prefetcher.warm(files(i));
+            end
+        end
+        
+        function trials = constructTrials(obj, results)
+            % Create OpenSimTrial objects which write to a results folder.
+            
+            trials = createTrials(obj.getModel(), obj.MotionFolderPath, ...
+                results, obj.ForcesFolderPath);
+            
+        end
+        
+        function copyAnalysisInputs(obj, results, analyses, indices)
+            % Copy the existing results which a set of analyses read.
+            %   The results of the analyses listed for each of the given
+            %   analyses in AnalysisInputs, and which aren't being run
+            %   themselves, are copied from the ResultsFolderPath in to the
+            %   same place within the given results folder, for each of the
+            %   trials given by indices. An analysis which isn't listed is
+            %   assumed to read the results of all others.
+            
+            if isempty(obj.Trials)
+                return;
+            end
+            needed = {};
+            for i=1:length(analyses)
+                if isfield(DatasetElement.AnalysisInputs, analyses{i})
+                    needed = [needed ...
+                        DatasetElement.AnalysisInputs.(analyses{i})];
+                else
+                    needed = [needed ...
+                        fieldnames(obj.Trials{1}.results_paths).'];
+                end
+            end
+            needed = setdiff(needed, analyses);
+            n = length(obj.ResultsFolderPath);
+            for i=indices
+                for j=1:length(needed)
+                    source = obj.Trials{i}.results_paths.(needed{j});
+                    if exist(source, 'dir') == 7
+                        copyfile(source, [results source(n + 1:end)]);
+                    end
+                end
+            end
+        end
+        
+        function runTrialAnalysis(obj, analysis, trials, index)
+            % Run one OpenSim analysis on one of a cell array of trials.
+            %   Analyses with a setup file in the ToolSettings of the
+            %   parent Dataset are run by the ToolPool of this process,
+            %   reusing the model initialised for an earlier trial, or for
+            %   RRA by runRRA, so that monitored and full runs use the same
+            %   setup. Others use runBatch.
+            
+            settings = obj.ParentDataset.ToolSettings;
+            if strcmp(analysis, 'RRA') && isfield(settings, 'RRA')
+                kinematics = [trials{index}.results_paths.IK filesep ...
+                    'ik.mot'];
+                times = readOpenSimTable(kinematics);
+                obj.runRRA(index, kinematics, ...
+                    trials{index}.results_paths.RRA, times([1, end], 1));
+                return;
+            end
+            if ~isfield(settings, analysis) || ...
+                    ~any(strcmp(ToolPool.Analyses, analysis))
+                runBatch({analysis}, trials(index), ...
+                    'load', obj.constructLoadPath());
+                return;
+            end
+            
+            pool = ToolPool.getPool();
+            inputs = obj.getFrameInputs(index);
+            output = trials{index}.results_paths.(analysis);
+            switch analysis
+                case 'IK'
+                    pool.runIK(obj.getModel(), settings.IK, inputs{1}, ...
+                        output);
+                case 'ID'
+                    pool.runID(obj.getModel(), settings.ID, ...
+                        [trials{index}.results_paths.IK filesep 'ik.mot'], ...
+                        inputs{2}, obj.constructLoadPath(), output);
+            end
+        end
+        
+        function prefix = runRRA(obj, index, kinematics, output, range)
+            % Run RRA on all or part of a trial, writing to an output folder.
+            %   RRA is run using the setup file given for it in the
+            %   ToolSettings of the parent Dataset, between the start and
+            %   end times given by range. Returns the path prefix of the
+            %   outputs, as for RRAResults.
+            
+            import org.opensim.modeling.*
+            
+            settings = obj.ParentDataset.ToolSettings;
+            if ~isfield(settings, 'RRA')
+                error(['Monitored RRA requires an RRA setup file in ' ...
+                    'ToolSettings.']);
+            end
+            if exist(output, 'dir') ~= 7
+                mkdir(output);
+            end
+            inputs = obj.getFrameInputs(index);
+            
+            % Point the loads at this trial's data.
+            loads = ExternalLoads(obj.constructLoadPath(), true);
+            loads.setDataFileName(inputs{2});
+            loads.setExternalLoadsModelKinematicsFileName(kinematics);
+            trial_loads = [output filesep 'external_loads.xml'];
+            loads.print(trial_loads);
+            
+            tool = RRATool(settings.RRA, false);
+            tool.setModel(Model(obj.getModel()));
+            tool.setExternalLoadsFileName(trial_loads);
+            tool.setDesiredKinematicsFileName(kinematics);
+            tool.setInitialTime(range(1));
+            tool.setFinalTime(range(2));
+            tool.setResultsDir(output);
+            tool.run();
+            prefix = [output filesep char(tool.getName())];
+        end
+        
         function path = constructSubjectFolderName(obj)
             % Construct the name of the subject specific folder.
             path = [obj.ParentDataset.SubjectPrefix num2str(obj.Subject)];
@@ -193,6 +1035,52 @@ classdef DatasetElement < handle
                 [path filesep name obj.ParentDataset.AdjustmentSuffix ext];
         end
         
+        function prefix = getRRAPrefix(obj, index)
+            % Get the path prefix of the RRA outputs of a trial.
+            %   Returns an empty array if RRA has not been run.
+            folder = obj.getRRAFolder(index);
+            files = dir([folder filesep '*_pErr.sto']);
+            if isempty(files)
+                prefix = [];
+            else
+                prefix = [folder filesep files(1).name(1:end - 9)];
+            end
+        end
+        
+        function summary = getResidualSummary(obj, index)
+            % Grade the RRA residuals of a trial.
+            %   The summary is cached next to the RRA outputs, and is only
+            %   recomputed if RRA has been re-run since it was saved.
+            
+            metrics = RRAResiduals.Metrics;
+            prefix = obj.getRRAPrefix(index);
+            if isempty(prefix)
+                summary.Grade = 'missing';
+                for i=1:length(metrics)
+                    summary.([metrics{i} '_Grade']) = '';
+                    summary.(metrics{i}) = NaN;
+                end
+                return;
+            end
+            
+            % Use the cached summary if it's up to date.
+            cache = [prefix '_residuals.mat'];
+            if isUpToDate(cache, {[prefix '_Actuation_force.sto'], ...
+                    [prefix '_pErr.sto']})
+                load(cache, 'summary');
+                return;
+            end
+            
+            % Otherwise analyse the RRA results and cache the summary.
+            result = RRAResults(obj.Trials{index}, prefix);
+            summary.Grade = result.Grade;
+            for i=1:length(metrics)
+                summary.([metrics{i} '_Grade']) = result.Residuals.Grades{i};
+                summary.(metrics{i}) = max(result.Residuals.(metrics{i}));
+            end
+            save(cache, 'summary');
+        end
+        
         function path = constructLoadPath(obj)
             % Construct path to the correct load descriptor xml file.
             name = obj.ParentDataset.LoadMap(...
@@ -201,6 +1089,17 @@ classdef DatasetElement < handle
         end
        
     end
+    
+    methods (Static, Access = private)
+        
+        function removeScratchFolder(folder, previous)
+            % Return to the previous working directory and remove a
+            % scratch folder.
+            cd(previous);
+            rmdir(folder, 's');
+        end
+        
+    end
 
 end
 
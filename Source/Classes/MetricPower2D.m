@@ -0,0 +1,227 @@
+% A class for estimating the statistical power of two-dimensional studies.
+% Given the MetricStats2D of an existing (e.g. pilot) dataset, virtual
+% studies are simulated by drawing normally distributed observations with
+% the same per-cell means and standard deviations, for each of a range of
+% sample sizes. Each virtual study is analysed as by MetricStats2D, i.e. a
+% two-way ANOVA followed by Tukey-Kramer multiple comparisons of the rows
+% and of the columns, and power is the proportion of studies in which each
+% effect or difference is found to be significant.
+classdef MetricPower2D < handle
+
+    properties (SetAccess = private)
+        name
+        means
+        sdevs
+        n_rows
+        n_cols
+        p_value = 0.05
+        row_descriptor
+        col_descriptor
+        sample_sizes
+        n_studies = 1000
+        seed = 0
+        effect_power % Row, column & interaction ANOVA power by sample size.
+        row_power % Power of each row difference, n_rows^2 x sample sizes.
+        col_power % Power of each column difference, n_cols^2 x sizes.
+    end
+    
+    properties (Constant, GetAccess = private)
+        batch_size = 250 % Studies per random substream.
+    end
+    
+    methods
+    
+        % The sample sizes are the numbers of observations per cell to
+        % simulate, each at least 2. Optionally sets the number of studies
+        % per sample size and the seed, which together fix the result
+        % regardless of the number of parallel workers.
+        function obj = MetricPower2D(stats, sample_sizes, n_studies, seed)
+            if nargin > 0
+                if any(sample_sizes < 2)
+                    error('Sample sizes must be at least 2.');
+                end
+                obj.name = stats.name;
+                obj.means = stats.means;
+                obj.sdevs = stats.sdevs;
+                obj.n_rows = stats.n_rows;
+                obj.n_cols = stats.n_cols;
+                obj.p_value = stats.p_value;
+                obj.row_descriptor = stats.row_descriptor;
+                obj.col_descriptor = stats.col_descriptor;
+                obj.sample_sizes = sample_sizes;
+                if nargin >= 3
+                    obj.n_studies = n_studies;
+                end
+                if nargin == 4
+                    obj.seed = seed;
+                end
+                obj.simulateStudies();
+            end
+        end
+        
+        % Simulates n_studies studies of each sample size, in batches
+        % across the parallel pool. Each batch draws from its own substream
+        % of a seeded generator, and is analysed at once by
+        % SPMStats2D.computeF, treating its studies as the nodes of one
+        % trajectory. The Tukey-Kramer critical values depend only on the
+        % design, so are found once per sample size by multcompare.
+        function simulateStudies(obj)
+        
+            % Critical values of the row and column comparisons.
+            n_sizes = length(obj.sample_sizes);
+            crit = zeros(2, n_sizes);
+            for s=1:n_sizes
+                crit(:, s) = MetricPower2D.tukeyCriticalValues(...
+                    obj.n_rows, obj.n_cols, obj.sample_sizes(s), ...
+                    obj.p_value);
+            end
+            
+            % Count the significant results of each batch of studies.
+            n_batches = ceil(obj.n_studies/obj.batch_size);
+            n_tasks = n_batches*n_sizes;
+            counts = cell(n_tasks, 1);
+            seed = obj.seed;
+            batch_size = obj.batch_size;
+            n_studies = obj.n_studies;
+            sample_sizes = obj.sample_sizes;
+            n_rows = obj.n_rows;
+            n_cols = obj.n_cols;
+            p_value = obj.p_value;
+            means = reshape(obj.means, 1, n_rows, n_cols);
+            sdevs = reshape(obj.sdevs, 1, n_rows, n_cols);
+            parfor t=1:n_tasks
+                [k, s] = ind2sub([n_batches, n_sizes], t);
+                stream = RandStream('mrg32k3a', 'Seed', seed);
+                stream.Substream = t;
+                n = sample_sizes(s);
+                m = min(batch_size, n_studies - (k - 1)*batch_size);
+                y = randn(stream, n, n_rows, n_cols, m).*sdevs + means;
+                [f, ms_err, row_means, col_means] = SPMStats2D.computeF(...
+                    reshape(y, n*n_rows, n_cols, m), n, n_rows);
+                counts{t} = MetricPower2D.countSignificant(f, ms_err, ...
+                    row_means, col_means, n, crit(:, s), p_value);
+            end
+            
+            % Convert the counts to power.
+            obj.effect_power = zeros(3, n_sizes);
+            obj.row_power = zeros(n_rows, n_rows, n_sizes);
+            obj.col_power = zeros(n_cols, n_cols, n_sizes);
+            for t=1:n_tasks
+                [~, s] = ind2sub([n_batches, n_sizes], t);
+                obj.effect_power(:, s) = ...
+                    obj.effect_power(:, s) + counts{t}.effects;
+                obj.row_power(:, :, s) = ...
+                    obj.row_power(:, :, s) + counts{t}.rows;
+                obj.col_power(:, :, s) = ...
+                    obj.col_power(:, :, s) + counts{t}.cols;
+            end
+            obj.effect_power = obj.effect_power/obj.n_studies;
+            obj.row_power = obj.row_power/obj.n_studies;
+            obj.col_power = obj.col_power/obj.n_studies;
+        end
+        
+        % Finds the smallest simulated sample size at which each of the
+        % row, column and interaction effects reaches the given power
+        % (default 0.8), or NaN if none does.
+        function sizes = calcRequiredSampleSizes(obj, target)
+            if nargin < 2
+                target = 0.8;
+            end
+            sizes = NaN(3, 1);
+            for i=1:3
+                first = find(obj.effect_power(i, :) >= target, 1);
+                if ~isempty(first)
+                    sizes(i) = obj.sample_sizes(first);
+                end
+            end
+        end
+        
+        % Plots the power of each pairwise difference along a direction,
+        % given by the row or column descriptor, against sample size.
+        function plotPowerCurves(obj, direction)
+            if strcmp(direction, obj.row_descriptor)
+                curves = obj.row_power;
+            elseif strcmp(direction, obj.col_descriptor)
+                curves = obj.col_power;
+            else
+                error(['Direction should match either the column or ' ...
+                    'row descriptor.']);
+            end
+            figure;
+            hold on;
+            legend_labels = {};
+            for i=1:size(curves, 1)
+                for j=i + 1:size(curves, 2)
+                    plot(obj.sample_sizes, squeeze(curves(i, j, :)), ...
+                        '-o', 'LineWidth', 2);
+                    legend_labels{end + 1} = ...
+                        sprintf('%d vs %d', i, j); %#ok<AGROW>
+                end
+            end
+            plot(obj.sample_sizes([1 end]), [0.8 0.8], 'k--');
+            hold off;
+            xlabel('Sample size', 'FontWeight', 'bold');
+            ylabel('Power', 'FontWeight', 'bold');
+            legend(legend_labels, 'Location', 'southeast');
+            title([obj.name ': ' direction], 'Interpreter', 'none');
+        end
+    
+    end
+    
+    methods (Static)
+    
+        % Finds the critical values of the Tukey-Kramer comparisons of rows
+        % and of columns which MetricStats2D makes by multcompare, for a
+        % given design. A difference is significant when it exceeds the
+        % critical value times its standard error, sqrt(2*MSE/n) where n is
+        % the number of observations per row or column mean.
+        function crit = tukeyCriticalValues(n_rows, n_cols, sample_size, ...
+                p_value)
+            [~, ~, stats] = anova2(randn(n_rows*sample_size, n_cols), ...
+                sample_size, 'off');
+            estimates = {'row', 'column'};
+            counts = [stats.rown, stats.coln];
+            crit = zeros(2, 1);
+            for i=1:2
+                comparison = multcompare(stats, 'Estimate', estimates{i}, ...
+                    'Alpha', p_value, 'Display', 'off');
+                crit(i) = (comparison(1, 5) - comparison(1, 4))/...
+                    sqrt(2*stats.sigmasq/counts(i));
+            end
+        end
+        
+        % Counts the studies of a batch with significant ANOVA effects and
+        % significant pairwise row and column differences. Differences
+        % are counted in upper triangular matrices, as row_sig_diffs and
+        % col_sig_diffs of MetricStats2D.
+        function counts = countSignificant(f, ms_err, row_means, ...
+                col_means, sample_size, crit, p_value)
+            n_rows = size(row_means, 1);
+            n_cols = size(col_means, 1);
+            df = [n_rows - 1; n_cols - 1; (n_rows - 1)*(n_cols - 1)];
+            df_err = n_rows*n_cols*(sample_size - 1);
+            p = 1 - fcdf(f, repmat(df, 1, size(f, 2)), df_err);
+            counts.effects = sum(p < p_value, 2);
+            counts.rows = MetricPower2D.countDifferences(row_means, ...
+                crit(1)*sqrt(2*ms_err/(n_cols*sample_size)));
+            counts.cols = MetricPower2D.countDifferences(col_means, ...
+                crit(2)*sqrt(2*ms_err/(n_rows*sample_size)));
+        end
+        
+        % Counts, for each pair of groups, the studies in which the
+        % difference between their means exceeds the threshold.
+        function counts = countDifferences(group_means, thresholds)
+            n_groups = size(group_means, 1);
+            counts = zeros(n_groups);
+            if n_groups < 2
+                return;
+            end
+            pairs = nchoosek(1:n_groups, 2);
+            differences = abs(group_means(pairs(:, 1), :) - ...
+                group_means(pairs(:, 2), :));
+            counts(sub2ind([n_groups, n_groups], pairs(:, 1), ...
+                pairs(:, 2))) = sum(differences > thresholds, 2);
+        end
+    
+    end
+end
@@ -0,0 +1,181 @@
+classdef NormalisedCycleStore < handle
+    % NormalisedCycleStore Time-normalised gait cycles of a whole Dataset.
+    %   Every channel of the chosen tables (e.g. IK and ID) of every cycle
+    %   is resampled once to Samples points from heel strike to heel strike,
+    %   and stored as a dense array of cycles by samples by channels per
+    %   table. Trajectory statistics and plots then become array slices,
+    %   e.g. the mean hip flexion angle of subject 1 is
+    %
+    %       rows = store.select('Subject', 1);
+    %       mean(store.getChannel('IK', 'hip_flexion_r', rows))
+    %
+    %   Index gives the element, trial, cycle, subject, side and context
+    %   parameter values of each row. Skipped lists, in the same way, the
+    %   cycles which couldn't be normalised (see normalise). Stores are
+    %   built by the buildCycleStore method of Dataset.
+    
+    properties (SetAccess = private)
+        Samples % Number of samples per cycle.
+        Labels = struct() % Channel labels of each table.
+        Values = struct() % Cycles x samples x channels array of each table.
+        Index % Table describing each cycle.
+        Skipped % Table describing each cycle which was skipped.
+    end
+    
+    methods
+    
+        function obj = NormalisedCycleStore(samples, labels, blocks, ...
+                index, skipped)
+            % Create a store from blocks of normalised cycles.
+            %   Blocks is a cell array of structs of normalised values, as
+            %   returned by normalise, which are concatenated in order.
+            %   Index has one row per cycle of the blocks. Optionally,
+            %   skipped has one row per cycle which was skipped.
+            if nargin > 0
+                obj.Samples = samples;
+                obj.Labels = labels;
+                obj.Index = index;
+                if nargin > 4
+                    obj.Skipped = skipped;
+                else
+                    obj.Skipped = index([], :);
+                end
+                tables = fieldnames(labels);
+                for i=1:length(tables)
+                    values = cellfun(@(x) x.(tables{i}), blocks, ...
+                        'UniformOutput', false);
+                    obj.Values.(tables{i}) = cat(1, values{:});
+                end
+            end
+        end
+        
+        function values = getChannel(obj, table, label, rows)
+            % Cycles x samples matrix of one channel of a table.
+            %   Optionally, rows selects the cycles to return.
+            column = find(strcmp(obj.Labels.(table), label));
+            if isempty(column)
+                error('Channel %s not found in table %s.', label, table);
+            end
+            if nargin < 4
+                rows = ':';
+            end
+            values = obj.Values.(table)(rows, :, column);
+        end
+        
+        function rows = select(obj, varargin)
+            % Logical index of cycles matching name-value pairs of Index.
+            %   For example, select('Subject', 2, 'Side', 'Right'). Numeric
+            %   values may be vectors, matching any of their elements.
+            rows = true(height(obj.Index), 1);
+            for i=1:2:length(varargin)
+                column = obj.Index.(varargin{i});
+                if iscell(column)
+                    rows = rows & strcmp(column, varargin{i + 1});
+                else
+                    rows = rows & ismember(column, varargin{i + 1});
+                end
+            end
+        end
+        
+        function [warped, paths] = register(obj, table, labels, ...
+                group, band)
+            % Register cycles of channels of a table by DTW.
+            %   Cycles are registered with registerCycles over the given
+            %   cell array of labels together. If group names a column of
+            %   Index, e.g. 'Subject', each group of cycles with equal
+            %   values is registered to its own template, otherwise all
+            %   cycles share one group template. Returns the warped cycles
+            %   and warping paths in the order of the store.
+            if nargin < 5
+                band = [];
+            end
+            columns = zeros(1, length(labels));
+            for i=1:length(labels)
+                column = find(strcmp(obj.Labels.(table), labels{i}));
+                if isempty(column)
+                    error('Channel %s not found in table %s.', ...
+                        labels{i}, table);
+                end
+                columns(i) = column;
+            end
+            if nargin < 4 || isempty(group)
+                groups = ones(obj.getNCycles(), 1);
+            else
+                [~, ~, groups] = unique(obj.Index.(group));
+            end
+            warped = zeros(obj.getNCycles(), obj.Samples, length(columns));
+            paths = cell(obj.getNCycles(), 1);
+            for g=1:max(groups)
+                members = groups == g;
+                [warped(members, :, :), paths(members)] = ...
+                    registerCycles(obj.Values.(table)(members, :, ...
+                    columns), [], band);
+            end
+        end
+        
+        function n = getNCycles(obj)
+            % Number of cycles in the store.
+            n = height(obj.Index);
+        end
+    
+    end
+    
+    methods (Static)
+    
+        function [values, labels, valid] = normalise(cycles, tables, ...
+                samples)
+            % Resample tables of an array of CycleViews to samples points.
+            %   Each cycle is splined over its range, one table at a time
+            %   with every channel at once. A cycle with fewer than two
+            %   frames of any of the tables in its range, e.g. where the IK
+            %   doesn't cover the times of the GRF events, can't be splined
+            %   and is skipped. Valid flags the cycles which were resampled,
+            %   and only these are returned.
+            valid = true(length(cycles), 1);
+            for j=1:length(cycles)
+                for i=1:length(tables)
+                    if diff(cycles(j).Frames.(tables{i})) < 1
+                        valid(j) = false;
+                    end
+                end
+            end
+            cycles = cycles(valid);
+            n_cycles = length(cycles);
+            values = struct();
+            labels = struct();
+            for i=1:length(tables)
+                if n_cycles == 0
+                    values.(tables{i}) = zeros(0, samples, 0);
+                    labels.(tables{i}) = {};
+                    continue;
+                end
+                labels.(tables{i}) = cycles(1).getLabels(tables{i});
+                values.(tables{i}) = zeros(n_cycles, samples, ...
+                    length(labels.(tables{i})));
+                for j=1:n_cycles
+                    query = linspace(cycles(j).Range(1), ...
+                        cycles(j).Range(2), samples).';
+                    values.(tables{i})(j, :, :) = interp1(...
+                        cycles(j).getTime(tables{i}), ...
+                        cycles(j).getTable(tables{i}), query, 'spline');
+                end
+            end
+        end
+        
+        function values = align(values, labels, reference, source)
+            % Reorder the channels of normalised values to match labels.
+            %   Values is a cycles x samples x channels array with the
+            %   given channel labels, which are reordered to those of the
+            %   reference labels. Errors, naming the source of the values,
+            %   if the two sets of labels differ.
+            [found, columns] = ismember(reference, labels);
+            if ~all(found) || length(labels) ~= length(reference)
+                error('Channels of %s differ from those of the first.', ...
+                    source);
+            end
+            values = values(:, :, columns);
+        end
+    
+    end
+
+end
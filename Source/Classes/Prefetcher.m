@@ -0,0 +1,72 @@
+classdef Prefetcher < handle
+    % Prefetcher Reads the input files of upcoming tasks in the background.
+    %   While one trial is being processed or loaded, the files of the next
+    %   few trials can be read from (possibly network) storage on a thread
+    %   of the background pool, so that compute and I/O overlap. Files are
+    %   read to warm the file system cache and then discarded, so that the
+    %   code which later reads them, e.g. OpenSim or MotionData, finds them
+    %   in memory.
+    %
+    %   Where no background pool is available, e.g. on parallel workers in
+    %   some MATLAB versions, warm does nothing.
+    
+    properties (SetAccess = private)
+        Depth % Number of tasks ahead to prefetch.
+    end
+    
+    properties (SetAccess = private, GetAccess = private)
+        Pool % Background pool, or empty if unavailable.
+        Futures % Map from file path to the future reading it.
+    end
+    
+    methods
+    
+        function obj = Prefetcher(depth)
+            % Create a Prefetcher which reads depth tasks ahead.
+            obj.Depth = depth;
+            obj.Futures = containers.Map();
+            try
+                obj.Pool = backgroundPool();
+            catch
+                obj.Pool = [];
+            end
+        end
+        
+        function warm(obj, files)
+            % Start reading a cell array of files in the background,
+            % skipping any already being read.
+            if isempty(obj.Pool)
+                return;
+            end
+            for i=1:length(files)
+                if ~isempty(files{i}) && ~isKey(obj.Futures, files{i})
+                    obj.Futures(files{i}) = parfeval(obj.Pool, ...
+                        @Prefetcher.readFile, 0, files{i});
+                end
+            end
+        end
+        
+        function delete(obj)
+            % Cancel any outstanding reads.
+            keys = obj.Futures.keys();
+            for i=1:length(keys)
+                cancel(obj.Futures(keys{i}));
+            end
+        end
+    
+    end
+    
+    methods (Static, Access = private)
+    
+        function readFile(path)
+            % Read a file, discarding its contents.
+            if exist(path, 'file') == 2
+                fid = fopen(path, 'r');
+                fread(fid, Inf, '*uint8');
+                fclose(fid);
+            end
+        end
+    
+    end
+
+end
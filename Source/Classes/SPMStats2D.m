@@ -0,0 +1,301 @@
+% A class for statistically analysing two-dimensional trajectory data.
+% The trajectory counterpart of MetricStats2D: rather than a single value
+% per observation, each observation is a time-normalised trajectory (e.g.
+% hip flexion over the gait cycle), and a two-way ANOVA is performed at
+% every node using statistical parametric mapping (SPM). Every subject
+% contributes one trajectory to every cell, so the ANOVA is of repeated
+% measures on both factors. Inference is by restricted permutation of the
+% maximum F statistic over nodes, which controls the family-wise error
+% rate over the whole trajectory.
+classdef SPMStats2D < handle
+
+    properties (SetAccess = private)
+        name
+        sample_size
+        n_rows
+        n_cols
+        n_nodes
+        p_value = 0.05
+        row_descriptor
+        col_descriptor
+        effects % Row, column and interaction effect labels.
+        n_permutations = 1000
+        seed = 0
+        f_values % Effects x nodes F statistics.
+        f_critical % Critical F of each effect.
+        p_values % Effects x nodes corrected p values.
+        clusters % Start & end nodes of suprathreshold clusters per effect.
+    end
+    
+    properties (Constant, GetAccess = private)
+        batch_size = 100 % Permutations per random substream.
+    end
+    
+    methods
+    
+        % Observations are arranged as for MetricStats2D with an extra
+        % third dimension over nodes, i.e. (n_rows*sample_size) x n_cols x
+        % n_nodes, as returned by arrangeCycles, with subject s in row s of
+        % each block of sample_size rows. At least two subjects are needed
+        % to estimate the error of each effect. Optionally sets the number
+        % of permutations and the seed, which together fix the result
+        % regardless of the number of parallel workers.
+        function obj = SPMStats2D(name, observations, sample_size, ...
+                row_descriptor, col_descriptor, n_permutations, seed)
+            if nargin > 0
+                if nargin < 5
+                    error('Non-empty SPMs require 5+ arguments.');
+                end
+                if sample_size < 2
+                    error('SPM of repeated measures needs 2+ subjects.');
+                end
+                obj.name = name;
+                obj.sample_size = sample_size;
+                obj.n_rows = size(observations, 1)/sample_size;
+                obj.n_cols = size(observations, 2);
+                obj.n_nodes = size(observations, 3);
+                obj.row_descriptor = row_descriptor;
+                obj.col_descriptor = col_descriptor;
+                obj.effects = {row_descriptor, col_descriptor, ...
+                    'interaction'};
+                if nargin >= 6
+                    obj.n_permutations = n_permutations;
+                end
+                if nargin == 7
+                    obj.seed = seed;
+                end
+                obj.f_values = SPMStats2D.computeRepeatedF(...
+                    observations, obj.sample_size, obj.n_rows);
+                obj.runPermutations(observations);
+                obj.identifyClusters();
+            end
+        end
+        
+        % Estimates the distribution of the maximum F over nodes for each
+        % effect by restricted permutations within subjects, in batches
+        % across the parallel pool. Under the null of no row effect, each
+        % subject's rows are exchangeable, so the rows of each subject are
+        % permuted independently, keeping their columns together, and
+        % likewise the columns for the column effect. For the interaction,
+        % the subject by row and subject by column means are removed and
+        % the residual trajectories permuted between the cells of each
+        % subject. Each batch draws from its own substream of a seeded
+        % generator. The critical F is the (1 - p_value) quantile of the
+        % distribution, and the corrected p value at a node is (1 + b)/(1 +
+        % n_permutations), where b permutations have a maximum F at least
+        % that at the node.
+        function runPermutations(obj, observations)
+        
+            % Separate the subjects, rows and columns.
+            n = obj.sample_size;
+            y = reshape(observations, n, obj.n_rows, obj.n_cols, ...
+                obj.n_nodes);
+            residuals = y - mean(y, 3) - mean(y, 2) + mean(mean(y, 2), 3);
+            
+            % Compute the maximum F of each permutation in batches.
+            n_batches = ceil(obj.n_permutations/obj.batch_size);
+            batches = cell(1, n_batches);
+            seed = obj.seed;
+            batch_size = obj.batch_size;
+            n_permutations = obj.n_permutations;
+            n_rows = obj.n_rows;
+            n_cols = obj.n_cols;
+            dims = size(observations);
+            parfor k=1:n_batches
+                stream = RandStream('mrg32k3a', 'Seed', seed);
+                stream.Substream = k;
+                m = min(batch_size, n_permutations - (k - 1)*batch_size);
+                batch = zeros(3, m);
+                for j=1:m
+                    rows = y;
+                    cols = y;
+                    cells = reshape(residuals, n, n_rows*n_cols, []);
+                    for s=1:n
+                        rows(s, :, :, :) = ...
+                            y(s, randperm(stream, n_rows), :, :);
+                        cols(s, :, :, :) = ...
+                            y(s, :, randperm(stream, n_cols), :);
+                        cells(s, :, :) = cells(s, ...
+                            randperm(stream, n_rows*n_cols), :);
+                    end
+                    f = [SPMStats2D.computeRepeatedF(reshape(rows, ...
+                        dims), n, n_rows); SPMStats2D.computeRepeatedF(...
+                        reshape(cols, dims), n, n_rows); ...
+                        SPMStats2D.computeRepeatedF(reshape(cells, ...
+                        dims), n, n_rows)];
+                    batch(:, j) = max(f([1, 5, 9], :), [], 2);
+                end
+                batches{k} = batch;
+            end
+            max_f = [batches{:}];
+            
+            % Critical F and corrected p values of each effect.
+            obj.f_critical = zeros(3, 1);
+            obj.p_values = zeros(3, obj.n_nodes);
+            for i=1:3
+                obj.f_critical(i) = quantile(max_f(i, :), 1 - obj.p_value);
+                obj.p_values(i, :) = (1 + ...
+                    sum(max_f(i, :).' >= obj.f_values(i, :), 1))/...
+                    (1 + obj.n_permutations);
+            end
+        end
+        
+        % Finds the clusters of consecutive nodes at which each effect
+        % exceeds its critical F. Clusters are returned as an n x 2 matrix
+        % of start and end nodes per effect.
+        function identifyClusters(obj)
+            obj.clusters = cell(1, 3);
+            for i=1:3
+                edges = diff([0, obj.f_values(i, :) > obj.f_critical(i), 0]);
+                obj.clusters{i} = [find(edges == 1).', ...
+                    find(edges == -1).' - 1];
+            end
+        end
+        
+        % Plots the F statistic of an effect, given by its descriptor or
+        % 'interaction', with its critical threshold and shaded clusters.
+        function plotSPM(obj, effect)
+            i = find(strcmp(obj.effects, effect));
+            if isempty(i)
+                error('Effect should be a descriptor or interaction.');
+            end
+            nodes = linspace(0, 100, obj.n_nodes);
+            figure;
+            hold on;
+            for j=1:size(obj.clusters{i}, 1)
+                range = obj.clusters{i}(j, 1):obj.clusters{i}(j, 2);
+                area(nodes(range), obj.f_values(i, range), ...
+                    obj.f_critical(i), 'FaceColor', [0.7 0.7 0.7], ...
+                    'EdgeColor', 'none');
+            end
+            plot(nodes, obj.f_values(i, :), 'k', 'LineWidth', 2);
+            plot(nodes([1 end]), obj.f_critical(i)*[1 1], 'r--');
+            hold off;
+            xlabel('% gait cycle', 'FontWeight', 'bold');
+            ylabel('SPM{F}', 'FontWeight', 'bold');
+            title([obj.name ': ' effect], 'Interpreter', 'none');
+        end
+    
+    end
+    
+    methods (Static)
+    
+        % Computes the F statistics of the row, column and interaction
+        % effects of a balanced two-way ANOVA with replication, as by
+        % anova2, at every node at once. Returns a 3 x n_nodes matrix.
+        % Optionally also returns the mean square error, and the row and
+        % column means, at each node, as n_nodes, n_rows x n_nodes and
+        % n_cols x n_nodes matrices.
+        function [f, ms_err, row_means, col_means] = ...
+                computeF(observations, sample_size, n_rows)
+            [~, n_cols, n_nodes] = size(observations);
+            y = reshape(observations, sample_size, n_rows, n_cols, n_nodes);
+            
+            % Cell, row, column and grand means at each node.
+            cell_means = mean(y, 1);
+            row_means = mean(cell_means, 3);
+            col_means = mean(cell_means, 2);
+            grand_mean = mean(row_means, 2);
+            
+            % Sums of squares and mean square error.
+            ss_row = n_cols*sample_size*sum((row_means - grand_mean).^2, 2);
+            ss_col = n_rows*sample_size*sum((col_means - grand_mean).^2, 3);
+            ss_int = sample_size*sum(sum((cell_means - row_means - ...
+                col_means + grand_mean).^2, 2), 3);
+            ss_err = sum(sum(sum((y - cell_means).^2, 1), 2), 3);
+            ms_err = ss_err/(n_rows*n_cols*(sample_size - 1));
+            
+            f = [reshape(ss_row./ms_err, 1, n_nodes)/(n_rows - 1); ...
+                reshape(ss_col./ms_err, 1, n_nodes)/(n_cols - 1); ...
+                reshape(ss_int./ms_err, 1, n_nodes)/...
+                ((n_rows - 1)*(n_cols - 1))];
+            ms_err = reshape(ms_err, 1, n_nodes);
+            row_means = reshape(row_means, n_rows, n_nodes);
+            col_means = reshape(col_means, n_cols, n_nodes);
+        end
+        
+        % Computes the F statistics of the row, column and interaction
+        % effects of a two-way ANOVA with repeated measures on both
+        % factors at every node at once, with observations arranged as
+        % for computeF and each replicate a subject. Each effect is tested
+        % against its interaction with subjects. Returns a 3 x n_nodes
+        % matrix.
+        function f = computeRepeatedF(observations, sample_size, n_rows)
+            [~, n_cols, n_nodes] = size(observations);
+            n = sample_size;
+            y = reshape(observations, n, n_rows, n_cols, n_nodes);
+            
+            % Cell, subject and marginal means at each node.
+            cell_means = mean(y, 1);
+            row_means = mean(cell_means, 3);
+            col_means = mean(cell_means, 2);
+            grand_mean = mean(row_means, 2);
+            subject_rows = mean(y, 3);
+            subject_cols = mean(y, 2);
+            subject_means = mean(subject_rows, 2);
+            
+            % Sums of squares of each effect and its error term.
+            ss_row = n_cols*n*sum((row_means - grand_mean).^2, 2);
+            ss_col = n_rows*n*sum((col_means - grand_mean).^2, 3);
+            ss_int = n*sum(sum((cell_means - row_means - col_means + ...
+                grand_mean).^2, 2), 3);
+            ss_row_err = n_cols*sum(sum((subject_rows - row_means - ...
+                subject_means + grand_mean).^2, 1), 2);
+            ss_col_err = n_rows*sum(sum((subject_cols - col_means - ...
+                subject_means + grand_mean).^2, 1), 3);
+            ss_int_err = sum(sum(sum((y - subject_rows - subject_cols - ...
+                cell_means + row_means + col_means + subject_means - ...
+                grand_mean).^2, 1), 2), 3);
+            
+            % The error degrees of freedom are those of the effect times
+            % n - 1, so cancel with them in each ratio.
+            f = (n - 1)*[reshape(ss_row./ss_row_err, 1, n_nodes); ...
+                reshape(ss_col./ss_col_err, 1, n_nodes); ...
+                reshape(ss_int./ss_int_err, 1, n_nodes)];
+        end
+        
+        % Arranges one channel of a NormalisedCycleStore for SPMStats2D.
+        % Rows and columns are the distinct values of two context
+        % parameters, and each cell holds one trajectory per subject, the
+        % mean of that subject's cycles in the cell, so sample_size is the
+        % number of subjects. Cycles of one subject aren't independent, so
+        % treating each as an observation would overstate the sample size.
+        % Optionally, only the first cycles_per_subject cycles of each
+        % subject in each cell are averaged, so that every subject is
+        % summarised by the same number of cycles.
+        function [observations, sample_size] = arrangeCycles(store, ...
+                table, label, row_descriptor, col_descriptor, ...
+                cycles_per_subject)
+            values = store.getChannel(table, label);
+            subjects = unique(store.Index.Subject);
+            row_values = unique(store.Index.(row_descriptor));
+            col_values = unique(store.Index.(col_descriptor));
+            sample_size = length(subjects);
+            observations = zeros(length(row_values)*sample_size, ...
+                length(col_values), store.Samples);
+            for i=1:length(row_values)
+                for j=1:length(col_values)
+                    for s=1:length(subjects)
+                        rows = find(store.select('Subject', subjects(s), ...
+                            row_descriptor, row_values(i), ...
+                            col_descriptor, col_values(j)));
+                        if nargin == 6
+                            n_cycles = cycles_per_subject;
+                        else
+                            n_cycles = max(length(rows), 1);
+                        end
+                        if length(rows) < n_cycles
+                            error(['Too few cycles for subject %d with ' ...
+                                '%s %g and %s %g.'], subjects(s), ...
+                                row_descriptor, row_values(i), ...
+                                col_descriptor, col_values(j));
+                        end
+                        observations((i - 1)*sample_size + s, j, :) = ...
+                            mean(values(rows(1:n_cycles), :), 1);
+                    end
+                end
+            end
+        end
+    
+    end
+end
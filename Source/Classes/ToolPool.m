@@ -0,0 +1,418 @@
+classdef ToolPool < handle
+    % ToolPool Initialised OpenSim models which are reused across trials.
+    %   Running an OpenSim tool means parsing the model and setup files,
+    %   building the model's system and, for ID, its external loads, which
+    %   for short trials and large models is a noticeable part of each run.
+    %   Trials within a DatasetElement share the same model and settings, so
+    %   a ToolPool keeps each model it initialises, with its state, keyed by
+    %   analysis, model, setup file and loads and their modification times,
+    %   and solves each trial directly with the IK or ID solver. Only the
+    %   per-trial inputs and time range change between runs, and a change
+    %   to any of the files creates a new model.
+    %
+    %   IK tracks the marker file with the marker weights and coordinate
+    %   tasks of the setup file, at its accuracy and constraint weight, and
+    %   writes the coordinates as the IK tool does. ID evaluates the
+    %   kinematics as the ID tool does (see evaluateKinematics) and, as for
+    %   an external loads kinematics file, re-expresses points given in
+    %   ground in the bodies the loads are applied to using the kinematics
+    %   filtered at the loads' lowpass_cutoff_frequency_for_load_kinematics.
+    %   Only the external forces are reconnected to each trial's GRFs, which
+    %   doesn't change the model's system, so neither initSystem nor the
+    %   external loads setup is repeated and nothing but the results is
+    %   written. Muscles are excluded from ID, as by the default ID tool
+    %   settings, and coordinate tasks which take their values from a file
+    %   are not supported.
+    %
+    %   Each MATLAB process, i.e. the client and each parallel worker, has
+    %   its own ToolPool, returned by ToolPool.getPool. Only IK and ID are
+    %   supported. Outputs are named as by OpenSimTrial, ik.mot and id.sto.
+    
+    properties (SetAccess = private)
+        Hits = 0 % Runs which reused a model.
+        Misses = 0 % Runs which initialised a model.
+    end
+    
+    properties (SetAccess = private, GetAccess = private)
+        Tools % Map from key to model, state and solver settings.
+    end
+    
+    properties (Constant)
+        Analyses = {'IK', 'ID'}
+    end
+    
+    methods
+    
+        function obj = ToolPool()
+            % Create an empty ToolPool.
+            obj.Tools = containers.Map();
+        end
+        
+        function runIK(obj, model, settings, markers, output, range)
+            % Run IK on a marker file, writing ik.mot to the output folder.
+            %   Optionally, range gives the start and end times to solve
+            %   between. By default the whole file is solved.
+            
+            import org.opensim.modeling.*
+            
+            entry = obj.getEntry('IK', model, settings, []);
+            values = readOpenSimTable(markers);
+            times = values(:, 2);
+            if nargin >= 6
+                times = times(times >= range(1) - 1e-9 & ...
+                    times <= range(2) + 1e-9);
+            end
+            
+            % Track the markers from the pooled state.
+            reference = MarkersReference(markers, entry.Weights);
+            solver = InverseKinematicsSolver(entry.Model, reference, ...
+                entry.References, entry.ConstraintWeight);
+            solver.setAccuracy(entry.Accuracy);
+            state = entry.State;
+            state.setTime(times(1));
+            solver.assemble(state);
+            coordinates = entry.Model.getCoordinateSet();
+            n_coordinates = coordinates.getSize();
+            q = zeros(length(times), n_coordinates);
+            for frame=1:length(times)
+                state.setTime(times(frame));
+                solver.track(state);
+                for j=1:n_coordinates
+                    q(frame, j) = coordinates.get(j - 1).getValue(state);
+                end
+            end
+            
+            ToolPool.createFolder(output);
+            q(:, entry.Rotational) = q(:, entry.Rotational)*180/pi;
+            writeOpenSimTable([output filesep 'ik.mot'], [times, q], ...
+                [{'time'}, entry.Coordinates], {'Coordinates', ...
+                'version=1', 'nRows=', 'nColumns=', 'inDegrees=yes'});
+        end
+        
+        function runID(obj, model, settings, kinematics, grfs, loads, ...
+                output)
+            % Run ID on a kinematics file and the GRFs given by the loads
+            % file, writing id.sto to the output folder.
+            
+            [entry, key] = obj.getEntry('ID', model, settings, loads);
+            motion = ToolPool.evaluateKinematics(kinematics, ...
+                entry.Cutoff, entry.LoadCutoff);
+            [forces, labels] = obj.solveFrames(key, grfs, motion);
+            ToolPool.createFolder(output);
+            writeOpenSimTable([output filesep 'id.sto'], ...
+                [motion.Time, forces], labels, ...
+                {'Inverse Dynamics Generalized Forces', 'version=1', ...
+                'nRows=', 'nColumns=', 'inDegrees=no'});
+        end
+            
+        function [forces, labels] = solveID(obj, model, settings, loads, ...
+                grfs, motion)
+            % Solve ID for evaluated kinematics under a loads file.
+            %   Motion is given by evaluateKinematics, or any subset of its
+            %   frames. Returns the generalised forces of each frame, without
+            %   a time column, and their labels, starting with 'time'.
+            
+            [~, key] = obj.getEntry('ID', model, settings, loads);
+            [forces, labels] = obj.solveFrames(key, grfs, motion);
+        end
+        
+        function clear(obj)
+            % Release all the models in the pool.
+            obj.Tools = containers.Map();
+        end
+    
+    end
+    
+    methods (Access = private)
+    
+        function [entry, key] = getEntry(obj, analysis, model, settings, ...
+                loads)
+            % Get a model from the pool, initialising it if necessary.
+            
+            import org.opensim.modeling.*
+            
+            files = {model, settings, char(loads)};
+            parts = {analysis};
+            for i=1:length(files)
+                if isempty(files{i})
+                    continue;
+                end
+                info = dir(files{i});
+                if isempty(info)
+                    error('File %s not found.', files{i});
+                end
+                parts = [parts, files(i), ...
+                    {datestr(info.datenum, 30)}]; %#ok<AGROW>
+            end
+            key = strjoin(parts, '|');
+            if isKey(obj.Tools, key)
+                obj.Hits = obj.Hits + 1;
+                entry = obj.Tools(key);
+                return;
+            end
+            
+            obj.Misses = obj.Misses + 1;
+            entry.Model = Model(model);
+            switch analysis
+                case 'IK'
+                    tool = InverseKinematicsTool(settings, false);
+                    entry.Accuracy = tool.get_accuracy();
+                    entry.ConstraintWeight = tool.get_constraint_weight();
+                    entry.State = entry.Model.initSystem();
+                    [entry.Weights, entry.References] = ...
+                        ToolPool.createReferences(entry.Model, ...
+                        tool.getIKTaskSet(), settings);
+                    coordinates = entry.Model.getCoordinateSet();
+                    n_coordinates = coordinates.getSize();
+                    entry.Coordinates = cell(1, n_coordinates);
+                    entry.Rotational = false(1, n_coordinates);
+                    for j=1:n_coordinates
+                        coordinate = coordinates.get(j - 1);
+                        entry.Coordinates{j} = char(coordinate.getName());
+                        entry.Rotational(j) = strcmp(...
+                            char(coordinate.getMotionType()), 'Rotational');
+                    end
+                case 'ID'
+                    tool = InverseDynamicsTool(settings, false);
+                    entry.Cutoff = tool.getLowpassCutoffFrequency();
+                    muscles = entry.Model.getMuscles();
+                    for j=0:muscles.getSize() - 1
+                        muscles.get(j).set_appliesForce(false);
+                    end
+                    entry.Loads = ExternalLoads(loads, true);
+                    entry.LoadCutoff = entry.Loads...
+                        .getLowpassCutoffFrequencyForLoadKinematics();
+                    n_forces = entry.Loads.getSize();
+                    entry.Frames = cell(1, n_forces);
+                    entry.Points = cell(1, n_forces);
+                    for j=1:n_forces
+                        force = entry.Loads.get(j - 1);
+                        entry.Frames{j} = ...
+                            char(force.get_point_expressed_in_body());
+                        entry.Points{j} = char(force.get_point_identifier());
+                    end
+                    entry.Model.addModelComponent(entry.Loads);
+                    entry.State = entry.Model.initSystem();
+                    entry.Solver = InverseDynamicsSolver(entry.Model);
+                    entry.Data = [];
+                otherwise
+                    error('Analysis %s cannot be pooled.', analysis);
+            end
+            obj.Tools(key) = entry;
+        end
+        
+        function [forces, labels] = solveFrames(obj, key, grfs, motion)
+            % Solve ID for the frames of evaluated kinematics.
+            
+            import org.opensim.modeling.*
+            
+            entry = obj.Tools(key);
+            model = entry.Model;
+            state = entry.State;
+            
+            % Map the kinematics columns to the model coordinates, in radians.
+            coordinates = model.getCoordinateSet();
+            n_coordinates = coordinates.getSize();
+            index = zeros(1, n_coordinates);
+            scale = ones(1, n_coordinates);
+            labels = cell(1, n_coordinates);
+            for j=1:n_coordinates
+                coordinate = coordinates.get(j - 1);
+                name = char(coordinate.getName());
+                column = find(strcmp(motion.Labels, name));
+                if isempty(column)
+                    error('Coordinate %s is missing from the kinematics.', ...
+                        name);
+                end
+                index(j) = column;
+                if strcmp(char(coordinate.getMotionType()), 'Rotational')
+                    labels{j} = [name '_moment'];
+                    if motion.InDegrees
+                        scale(j) = pi/180;
+                    end
+                else
+                    labels{j} = [name '_force'];
+                end
+            end
+            labels = [{'time'}, labels];
+            
+            % Point the external forces at this trial's GRFs, with the
+            % points given in ground re-expressed in their bodies over the
+            % frames being solved. The Storages are kept with the model,
+            % which refers to them.
+            entry.Data = Storage(grfs);
+            for j=1:entry.Loads.getSize()
+                force = entry.Loads.get(j - 1);
+                force.set_point_expressed_in_body(entry.Frames{j});
+                force.set_point_identifier(entry.Points{j});
+                force.setDataSource(entry.Data);
+            end
+            entry.Kinematics = Storage();
+            entry.Kinematics.setInDegrees(false);
+            names = ArrayStr();
+            names.append('time');
+            for j=1:n_coordinates
+                names.append(coordinates.get(j - 1).getName());
+            end
+            entry.Kinematics.setColumnLabels(names);
+            n_frames = length(motion.Time);
+            row = Vector(n_coordinates, 0);
+            for frame=1:n_frames
+                for j=1:n_coordinates
+                    row.set(j - 1, motion.LoadQ(frame, index(j))*scale(j));
+                end
+                entry.Kinematics.append(motion.Time(frame), row);
+            end
+            entry.Loads.transformPointsExpressedInGroundToAppliedBodies(...
+                entry.Kinematics, motion.Time(1), motion.Time(end));
+            for j=1:entry.Loads.getSize()
+                entry.Loads.get(j - 1).finalizeConnections(model);
+            end
+            obj.Tools(key) = entry;
+            
+            % Solve each frame, assembling the model to satisfy its
+            % constraints before the speeds are set.
+            forces = zeros(n_frames, n_coordinates);
+            accelerations = Vector(n_coordinates, 0);
+            for frame=1:n_frames
+                state.setTime(motion.Time(frame));
+                for j=1:n_coordinates
+                    coordinates.get(j - 1).setValue(state, ...
+                        motion.Q(frame, index(j))*scale(j), false);
+                end
+                model.assemble(state);
+                for j=1:n_coordinates
+                    coordinates.get(j - 1).setSpeedValue(...
+                        state, motion.U(frame, index(j))*scale(j));
+                    accelerations.set(j - 1, ...
+                        motion.UDot(frame, index(j))*scale(j));
+                end
+                model.realizeVelocity(state);
+                result = entry.Solver.solve(state, accelerations);
+                for j=1:n_coordinates
+                    forces(frame, j) = result.get(j - 1);
+                end
+            end
+        end
+    
+    end
+    
+    methods (Static)
+    
+        function pool = getPool()
+            % The ToolPool of this MATLAB process.
+            persistent instance;
+            if isempty(instance) || ~isvalid(instance)
+                instance = ToolPool();
+            end
+            pool = instance;
+        end
+    
+        function motion = evaluateKinematics(kinematics, cutoff, load_cutoff)
+            % Evaluate a kinematics file as the ID tool does.
+            %   The coordinates are low-pass filtered at cutoff, if it is
+            %   positive, then fitted with quintic GCV splines whose
+            %   derivatives give the speeds and accelerations at each frame.
+            %   Returns a struct of the frame times (Time), the column labels
+            %   (Labels), whether they are in degrees (InDegrees) and the
+            %   evaluated coordinates, speeds and accelerations (Q, U and
+            %   UDot, one column per label). LoadQ holds the coordinates
+            %   filtered at load_cutoff instead, if it is positive, which
+            %   locate the external loads as an external loads kinematics
+            %   file would. Rows may be selected from every field but the
+            %   labels and units to solve a subset of the frames.
+            
+            import org.opensim.modeling.*
+            
+            [values, labels, header] = readOpenSimTable(kinematics);
+            motion.Time = values(:, 1);
+            motion.InDegrees = ...
+                any(strcmpi(strtrim(header), 'inDegrees=yes'));
+            
+            storage = Storage(kinematics);
+            if cutoff > 0
+                storage.pad(floor(storage.getSize()/2));
+                storage.lowpassIIR(cutoff);
+            end
+            splines = GCVSplineSet(5, storage);
+            n_columns = splines.getSize();
+            n_frames = length(motion.Time);
+            motion.Labels = cell(1, n_columns);
+            motion.Q = zeros(n_frames, n_columns);
+            motion.U = zeros(n_frames, n_columns);
+            motion.UDot = zeros(n_frames, n_columns);
+            for j=1:n_columns
+                motion.Labels{j} = char(splines.get(j - 1).getName());
+                for frame=1:n_frames
+                    time = motion.Time(frame);
+                    motion.Q(frame, j) = splines.evaluate(j - 1, 0, time);
+                    motion.U(frame, j) = splines.evaluate(j - 1, 1, time);
+                    motion.UDot(frame, j) = splines.evaluate(j - 1, 2, time);
+                end
+            end
+            motion.LoadQ = ToolPool.filterLoadKinematics(...
+                values, labels, motion.Labels, load_cutoff);
+        end
+            
+        function q = filterLoadKinematics(values, labels, columns, cutoff)
+            % Filter the coordinates which locate the external loads.
+            %   Values and labels are read from a kinematics file, with time
+            %   in the first column. The coordinates are low-pass filtered
+            %   at cutoff, if it is positive, and returned in the order of
+            %   the given column labels, as the LoadQ of evaluateKinematics.
+            
+            if cutoff > 0 && size(values, 1) > 1
+                values = zeroPhaseFilter(values, ...
+                    1/mean(diff(values(:, 1))), cutoff, 2:size(values, 2));
+            end
+            [~, columns] = ismember(columns, labels);
+            q = values(:, columns);
+        end
+    
+    end
+    
+    methods (Static, Access = private)
+    
+        function createFolder(folder)
+            % Create a folder if it doesn't already exist.
+            if exist(folder, 'dir') ~= 7
+                mkdir(folder);
+            end
+        end
+    
+        function [weights, references] = createReferences(model, tasks, ...
+                settings)
+            % Create the marker weights and coordinate references of the
+            % tasks of an IK setup file.
+            
+            import org.opensim.modeling.*
+            
+            weights = SetMarkerWeights();
+            tasks.createMarkerWeightSet(weights);
+            references = SimTKArrayCoordinateReference();
+            coordinates = model.getCoordinateSet();
+            for i=1:tasks.getSize()
+                task = IKCoordinateTask.safeDownCast(tasks.get(i - 1));
+                if isempty(task) || ~task.getApply()
+                    continue;
+                end
+                name = char(task.getName());
+                switch char(task.getPropertyByName('value_type').toString())
+                    case 'from_file'
+                        error(['Coordinate task %s of %s takes its ' ...
+                            'values from a file, which ToolPool does ' ...
+                            'not support.'], name, settings);
+                    case 'manual_value'
+                        value = task.getValue();
+                    otherwise
+                        value = coordinates.get(name).getDefaultValue();
+                end
+                reference = CoordinateReference(name, Constant(value));
+                reference.setWeight(task.getWeight());
+                references.push_back(reference);
+            end
+        end
+        
+    end
+
+end
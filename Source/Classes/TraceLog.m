@@ -0,0 +1,231 @@
+classdef TraceLog
+    % TraceLog Structured timing and resource trace of Dataset processing.
+    %   A TraceLog records the start and end of each stage of processing or
+    %   loading - which worker ran it, for which element, trial and
+    %   analysis, how many bytes were read and written and the peak memory
+    %   of the process. Each worker appends events to its own CSV file
+    %   within the trace folder, so workers never contend for a file.
+    %
+    %   Tracing is enabled by setting the TraceFolder property of a Dataset.
+    %   The summarise method reads back all the events in a trace folder and
+    %   reports time per analysis, per-worker utilisation and stragglers.
+    
+    properties (SetAccess = private)
+        Folder
+    end
+    
+    properties (Constant)
+        % Column names of the trace files, in order.
+        Columns = {'Stage', 'Element', 'Trial', 'Analysis', 'Worker', ...
+            'Start', 'Finish', 'Duration', 'BytesRead', 'BytesWritten', ...
+            'PeakMemory'}
+    end
+    
+    methods
+    
+        function obj = TraceLog(folder)
+            % A TraceLog writes to the given folder. An empty folder
+            % creates a disabled TraceLog, for which start and finish do
+            % nothing.
+            
+            obj.Folder = folder;
+            if obj.isEnabled() && exist(folder, 'dir') ~= 7
+                mkdir(folder);
+            end
+        end
+        
+        function result = isEnabled(obj)
+            % True if events are being recorded.
+            result = ~isempty(obj.Folder);
+        end
+        
+        function event = start(obj, stage, element, trial, analysis, ...
+                inputs)
+            % Mark the start of an event.
+            %   Element is a name for the DatasetElement and trial the index
+            %   of the trial, or 0 for events covering a whole element.
+            %   Inputs is a cell array of the files read by the event, which
+            %   can be empty. The returned event should be passed to finish.
+            
+            event = [];
+            if ~obj.isEnabled()
+                return;
+            end
+            if isempty(analysis)
+                analysis = '-';
+            end
+            event.Stage = stage;
+            event.Element = element;
+            event.Trial = trial;
+            event.Analysis = analysis;
+            event.BytesRead = 0;
+            for i=1:length(inputs)
+                event.BytesRead = ...
+                    event.BytesRead + TraceLog.countBytes(inputs{i});
+            end
+            event.Start = posixtime(datetime('now'));
+        end
+        
+        function finish(obj, event, outputs)
+            % Mark the end of an event and append it to the trace.
+            %   Outputs is an optional cell array of the files written by
+            %   the event, or of folders whose files (but not subfolders)
+            %   it wrote.
+            
+            if ~obj.isEnabled()
+                return;
+            end
+            finish_time = posixtime(datetime('now'));
+            written = 0;
+            if nargin == 3
+                for i=1:length(outputs)
+                    written = written + TraceLog.countBytes(outputs{i});
+                end
+            end
+            worker = TraceLog.getWorker();
+            path = [obj.Folder filesep sprintf('trace_worker%d.csv', worker)];
+            fid = fopen(path, 'a');
+            if fid == -1
+                error('Unable to open trace file %s for writing.', path);
+            end
+            if ftell(fid) == 0
+                fprintf(fid, '%s\n', strjoin(TraceLog.Columns, ','));
+            end
+            fprintf(fid, '%s,%s,%d,%s,%d,%.6f,%.6f,%.6f,%d,%d,%d\n', ...
+                event.Stage, event.Element, event.Trial, event.Analysis, ...
+                worker, event.Start, finish_time, ...
+                finish_time - event.Start, ...
+                event.BytesRead, written, TraceLog.getPeakMemory());
+            fclose(fid);
+        end
+    
+    end
+    
+    methods (Static)
+    
+        function events = read(folder)
+            % Read all the events in a trace folder in to one table.
+            
+            listing = dir([folder filesep 'trace_worker*.csv']);
+            tables = cell(length(listing), 1);
+            for i=1:length(listing)
+                tables{i} = readtable([folder filesep listing(i).name], ...
+                    'Delimiter', ',', 'TextType', 'char');
+            end
+            events = vertcat(tables{:});
+            events = sortrows(events, 'Start');
+        end
+        
+        function report = summarise(folder)
+            % Summarise the events in a trace folder.
+            %   Returns a struct with three tables:
+            %     Analyses - count, total, mean and max duration of each
+            %                stage/analysis pair.
+            %     Workers - events run, busy time and utilisation of each
+            %               worker over the span of the trace.
+            %     Stragglers - trial events taking more than three scaled
+            %                  median absolute deviations longer than the
+            %                  median for their analysis.
+            
+            events = TraceLog.read(folder);
+            
+            % Time per analysis type.
+            [groups, stage, analysis] = ...
+                findgroups(events.Stage, events.Analysis);
+            report.Analyses = table(stage, analysis, ...
+                splitapply(@length, events.Duration, groups), ...
+                splitapply(@sum, events.Duration, groups), ...
+                splitapply(@mean, events.Duration, groups), ...
+                splitapply(@max, events.Duration, groups), ...
+                'VariableNames', ...
+                {'Stage', 'Analysis', 'Count', 'Total', 'Mean', 'Max'});
+            
+            % Per-worker utilisation. Events can contain others, e.g. an
+            % element contains its trials, so only the outermost events of
+            % each worker count as busy time.
+            span = max(events.Finish) - min(events.Start);
+            outer = TraceLog.getOuterEvents(events);
+            [groups, worker] = findgroups(outer.Worker);
+            busy = splitapply(@sum, outer.Duration, groups);
+            report.Workers = table(worker, ...
+                splitapply(@length, outer.Duration, groups), busy, ...
+                busy/span, 'VariableNames', ...
+                {'Worker', 'Events', 'Busy', 'Utilisation'});
+            
+            % Straggler trials.
+            trials = events(events.Trial > 0, :);
+            [groups, ~] = findgroups(trials.Stage, trials.Analysis);
+            medians = splitapply(@median, trials.Duration, groups);
+            deviations = splitapply(@(x) 1.4826*mad(x, 1), ...
+                trials.Duration, groups);
+            limit = medians(groups) + 3*deviations(groups);
+            report.Stragglers = sortrows(...
+                trials(trials.Duration > limit, :), 'Duration', 'descend');
+        end
+    
+    end
+    
+    methods (Static, Access = private)
+    
+        function bytes = countBytes(path)
+            % Total size of a file, or of the files directly in a folder.
+            bytes = 0;
+            if isempty(path)
+                return;
+            end
+            listing = dir(path);
+            if ~isempty(listing)
+                bytes = sum([listing(~[listing.isdir]).bytes]);
+            end
+        end
+        
+        function outer = getOuterEvents(events)
+            % Events which aren't contained in another event of their
+            % worker.
+            events = sortrows(events, {'Worker', 'Start', 'Finish'}, ...
+                {'ascend', 'ascend', 'descend'});
+            workers = events.Worker;
+            finishes = events.Finish;
+            keep = true(height(events), 1);
+            reach = -Inf;
+            for i=1:height(events)
+                if i > 1 && workers(i) ~= workers(i - 1)
+                    reach = -Inf;
+                end
+                keep(i) = finishes(i) > reach;
+                reach = max(reach, finishes(i));
+            end
+            outer = events(keep, :);
+        end
+        
+        function worker = getWorker()
+            % ID of the current parallel worker, or 0 on the client.
+            task = getCurrentTask();
+            if isempty(task)
+                worker = 0;
+            else
+                worker = task.ID;
+            end
+        end
+        
+        function bytes = getPeakMemory()
+            % Peak memory of this process, in bytes, if it can be measured.
+            %   On Linux this is the high water mark of the resident set. On
+            %   Windows the memory function only reports current usage, so
+            %   that is used instead. Returns 0 elsewhere.
+            bytes = 0;
+            if isunix() && exist('/proc/self/status', 'file') == 2
+                status = fileread('/proc/self/status');
+                peak = regexp(status, 'VmHWM:\s*(\d+)', 'tokens', 'once');
+                if ~isempty(peak)
+                    bytes = 1024*str2double(peak{1});
+                end
+            elseif ispc()
+                user = memory;
+                bytes = user.MemUsedMATLAB;
+            end
+        end
+    
+    end
+
+end
@@ -0,0 +1,54 @@
+classdef TrialStore < handle
+    % TrialStore The loaded tables of a trial, shared by its cycle views.
+    %   Each table, e.g. the markers, forces or IK and ID results of a
+    %   trial, is held once as a matrix of frames by channels. Being a
+    %   handle, a TrialStore is never copied when CycleViews of it are
+    %   created or passed around, so splitting a trial in to cycles costs
+    %   only the frame ranges of each cycle.
+    
+    properties (SetAccess = private)
+        Tables = struct() % Struct of tables with Time, Values and Labels.
+    end
+    
+    methods
+    
+        function add(obj, name, values, labels)
+            % Add an OpenSim table, as from readOpenSimTable, by name.
+            %   The time column is split off and the remaining columns
+            %   stored with their labels.
+            time = strcmpi(labels, 'time');
+            if ~any(time)
+                error('Table %s has no time column.', name);
+            end
+            obj.Tables.(name).Time = values(:, time);
+            obj.Tables.(name).Values = values(:, ~time);
+            obj.Tables.(name).Labels = labels(~time);
+        end
+        
+        function names = getTableNames(obj)
+            % Names of the tables in the store.
+            names = fieldnames(obj.Tables).';
+        end
+        
+        function frames = findFrames(obj, name, range)
+            % First and last frames of a table within a time range.
+            time = obj.Tables.(name).Time;
+            frames = [find(time >= range(1), 1), find(time <= range(2), 1, ...
+                'last')];
+            if length(frames) ~= 2 || frames(2) < frames(1)
+                frames = [1, 0];
+            end
+        end
+        
+        function columns = findColumns(obj, name, labels)
+            % Column indices of a cell array of labels in a table.
+            [found, columns] = ismember(labels, obj.Tables.(name).Labels);
+            if ~all(found)
+                error('Labels %s not found in table %s.', ...
+                    strjoin(labels(~found), ', '), name);
+            end
+        end
+    
+    end
+
+end
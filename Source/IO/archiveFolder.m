@@ -0,0 +1,87 @@
+function archiveFolder(folder)
+% Losslessly compresses a folder in to an HDF5 archive alongside it.
+%   Every file in the folder and its subfolders is stored in the archive
+%   [folder '.h5'], keyed by its path relative to the folder. Tables
+%   (.sto, .mot and .trc files) are parsed and stored as byte shuffled,
+%   deflated doubles, but only if formatting the parsed values reproduces
+%   the original file byte for byte. Anything else - other files, or tables
+%   written with an unusual layout - is stored as deflated raw bytes. The
+%   archive can therefore always be restored exactly, see extractArchive.
+%
+%   The archive replaces the folder. It is written under a temporary name
+%   and only renamed, and the folder removed, once every file is stored, so
+%   a failed run leaves the folder as it was. A folder with no files is
+%   left as it is. readOpenSimTable reads tables straight from the archive
+%   (see findContainer), and DatasetElement extracts archived trials when
+%   their folders are needed on disk.
+
+archive = [folder '.h5'];
+if exist(archive, 'file') == 2
+    error('Archive %s already exists.', archive);
+end
+listing = dir([folder filesep '**' filesep '*']);
+listing = listing(~[listing.isdir]);
+if isempty(listing)
+    return;
+end
+temp = [folder '.' char(java.util.UUID.randomUUID()) '.h5.tmp'];
+
+try
+    for i=1:length(listing)
+        path = [listing(i).folder filesep listing(i).name];
+        key = strrep(path(length(folder) + 2:end), filesep, '/');
+        fid = fopen(path, 'r');
+        if fid == -1
+            error('Unable to open %s.', path);
+        end
+        bytes = fread(fid, [1, Inf], '*uint8');
+        fclose(fid);
+        if ~archiveTable(temp, key, path, bytes)
+            writeContainerFile(temp, key, bytes);
+        end
+    end
+catch err
+    if exist(temp, 'file') == 2
+        delete(temp);
+    end
+    rethrow(err);
+end
+
+[success, message] = movefile(temp, archive);
+if ~success
+    delete(temp);
+    error('Unable to write %s: %s', archive, message);
+end
+rmdir(folder, 's');
+
+end
+
+function stored = archiveTable(archive, key, path, bytes)
+% Store a file as a table if it can be reproduced exactly from its values.
+
+stored = false;
+[~, ~, ext] = fileparts(path);
+if ~any(strcmpi(ext, {'.sto', '.mot', '.trc'}))
+    return;
+end
+
+% Use the number of decimal places of the last value in the file.
+contents = char(bytes);
+decimals = regexp(contents, '\.(\d+)\s*$', 'tokens', 'once');
+if isempty(decimals) || any(contents == sprintf('\r'))
+    return;
+end
+precision = length(decimals{1});
+
+try
+    [values, labels, header] = parseOpenSimTable(contents, path);
+    if strcmp(formatOpenSimTable(...
+            path, values, labels, header, precision), contents)
+        writeContainerTable(archive, key, values, labels, header, precision);
+        stored = true;
+    end
+catch
+    % Fall back to storing the raw bytes.
+end
+
+end
@@ -0,0 +1,48 @@
+function commitFolder(source, destination)
+% Moves a finished folder of results over its destination atomically.
+%   The source folder is first moved alongside the destination under a
+%   temporary name, which may be a slow copy if it is on another file
+%   system, e.g. a local scratch folder and network storage. Any old
+%   destination is then renamed aside, the temporary folder renamed in its
+%   place and only then is the old folder removed, so readers never see a
+%   partially copied folder and the old results are kept if the swap
+%   fails. Does nothing if the source doesn't exist.
+
+if exist(source, 'dir') ~= 7
+    return;
+end
+parent = fileparts(destination);
+if exist(parent, 'dir') ~= 7
+    mkdir(parent);
+end
+
+% Move to a temporary folder next to the destination.
+id = char(java.util.UUID.randomUUID());
+temp = [destination '.' id '.tmp'];
+[success, message] = movefile(source, temp);
+if ~success
+    error('Unable to move %s: %s', source, message);
+end
+
+% Rename the old destination aside, then swap in the new folder.
+old = [];
+if exist(destination, 'dir') == 7
+    old = [destination '.' id '.old'];
+    [success, message] = movefile(destination, old);
+    if ~success
+        rmdir(temp, 's');
+        error('Unable to replace %s: %s', destination, message);
+    end
+end
+[success, message] = movefile(temp, destination);
+if ~success
+    if ~isempty(old)
+        movefile(old, destination);
+    end
+    error('Unable to commit %s: %s', destination, message);
+end
+if ~isempty(old)
+    rmdir(old, 's');
+end
+
+end
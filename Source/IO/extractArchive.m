@@ -0,0 +1,25 @@
+function extractArchive(archive, remove, folder)
+% Restores the folder an archive was made from by archiveFolder.
+%   The folder is recreated exactly as it was when archived, alongside the
+%   archive or, if given, at folder, e.g. within a scratch folder. If
+%   remove is true the archive is deleted afterwards.
+
+if nargin < 2
+    remove = false;
+end
+if nargin < 3
+    [parent, name] = fileparts(archive);
+    folder = [parent filesep name];
+end
+
+keys = listContainerKeys(h5info(archive));
+for i=1:length(keys)
+    restoreContainerFile(archive, keys{i}, ...
+        [folder filesep strrep(keys{i}, '/', filesep)]);
+end
+
+if remove
+    delete(archive);
+end
+
+end
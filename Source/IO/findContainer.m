@@ -0,0 +1,28 @@
+function [container, key] = findContainer(path)
+% Finds the HDF5 container holding the table of a file which isn't on disk.
+%   The container of a folder is stored alongside it, with the same name
+%   and a .h5 extension. For example the archive of the trial results
+%   folder C:\Results\Trial01 is C:\Results\Trial01.h5, see archiveFolder.
+%   The parent folders of path are searched from the nearest upwards, and
+%   the first container found is returned along with the key of the file
+%   within it. Returns empty arrays if no container is found.
+
+container = [];
+key = [];
+[folder, name, ext] = fileparts(path);
+relative = [name ext];
+while ~isempty(folder)
+    if exist([folder '.h5'], 'file') == 2
+        container = [folder '.h5'];
+        key = relative;
+        return;
+    end
+    [parent, name, ext] = fileparts(folder);
+    if strcmp(parent, folder)
+        return;
+    end
+    relative = [name ext '/' relative];
+    folder = parent;
+end
+
+end
@@ -0,0 +1,73 @@
+function contents = formatOpenSimTable(...
+    path, values, labels, header, precision)
+% Formats a dense matrix as the contents of an OpenSim .sto/.mot or .trc file.
+%   See writeOpenSimTable for a description of the inputs. An empty
+%   precision selects the default for the file format. The values are
+%   formatted by a single call to sprintf.
+
+% Get the header as a cell array of lines, without any endheader line.
+if ischar(header) && size(header, 1) > 1
+    header = cellstr(header);
+elseif ischar(header) && ~isempty(header)
+    header = regexp(strtrim(header), '\n', 'split');
+end
+header = header(~strcmp(strtrim(header), 'endheader'));
+
+% Format the file contents.
+[~, name, ext] = fileparts(path);
+if strcmpi(ext, '.trc')
+    if isempty(precision)
+        precision = 6;
+    end
+    contents = formatTRC(values, labels, header, precision);
+else
+    if isempty(precision)
+        precision = 14;
+    end
+    if isempty(header)
+        header = {name, 'version=1', 'nRows=', 'nColumns=', 'inDegrees=yes'};
+    end
+    contents = formatSTO(values, labels, header, precision);
+end
+
+end
+
+function contents = formatSTO(values, labels, header, precision)
+% Header, endheader, labels, then the values.
+
+[n_rows, n_columns] = size(values);
+header = regexprep(header, '^nRows=.*', sprintf('nRows=%d', n_rows));
+header = regexprep(header, '^nColumns=.*', ...
+    sprintf('nColumns=%d', n_columns));
+row_format = [repmat(sprintf('%%.%df\\t', precision), 1, n_columns) '\n'];
+contents = [sprintf('%s\n', header{:}) sprintf('endheader\n') ...
+    sprintf('%s\t', labels{:}) sprintf('\n') sprintf(row_format, values.')];
+
+end
+
+function contents = formatTRC(values, labels, header, precision)
+% Header, marker names, co-ordinate names, a blank line, then the values.
+
+[n_rows, n_columns] = size(values);
+n_markers = (n_columns - 2)/3;
+
+% Update the frame and marker counts.
+keys = regexp(header{2}, '\t', 'split');
+entries = regexp(header{3}, '\t', 'split');
+entries{strcmp(keys, 'NumFrames')} = num2str(n_rows);
+entries{strcmp(keys, 'NumMarkers')} = num2str(n_markers);
+header{3} = strjoin(entries, sprintf('\t'));
+
+% Recover the marker names from the per-axis labels.
+markers = cellfun(@(x) x(1:end - 1), labels(3:3:end), ...
+    'UniformOutput', false);
+coordinates = sprintf('X%d\tY%d\tZ%d\t', repmat(1:n_markers, 3, 1));
+
+row_format = ['%d\t' repmat(sprintf('%%.%df\\t', precision), ...
+    1, n_columns - 1) '\n'];
+contents = [sprintf('%s\n', header{:}) ...
+    sprintf('%s\t%s\t', labels{1:2}) ...
+    strjoin(markers, sprintf('\t\t\t')) sprintf('\t\t\n') ...
+    sprintf('\t\t%s\n\n', coordinates) sprintf(row_format, values.')];
+
+end
@@ -0,0 +1,14 @@
+function keys = listContainerKeys(group)
+% Recursively lists the keys of the files stored in an HDF5 container.
+%   Takes the output of h5info, or any group within it.
+
+keys = {};
+if ~isempty(group.Datasets) && ...
+        any(ismember({group.Datasets.Name}, {'values', 'raw'}))
+    keys = {group.Name(2:end)};
+end
+for i=1:length(group.Groups)
+    keys = [keys, listContainerKeys(group.Groups(i))]; %#ok<AGROW>
+end
+
+end
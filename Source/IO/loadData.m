@@ -0,0 +1,34 @@
+function data = loadData(path, constructor)
+% Reads a .sto/.mot or .trc file in to a Data object.
+%   A replacement for constructing a Data object directly from a file when
+%   the object is only read from, using the faster readOpenSimTable to do
+%   the parsing. The Values, Labels, Timesteps and Frames are those Data
+%   would read. The Header is the header lines as a cell array, in the form
+%   writeData expects, so objects whose header is to be rewritten by Data
+%   methods such as updateHeader should still be constructed by Data.
+%   Use verifyDataIO to check the two agree on a set of files.
+%
+%   Optionally, constructor creates the empty object to fill, e.g. @RRAData
+%   for RRA outputs which have already had their intermediate timesteps
+%   removed. By default this is @Data.
+
+if nargin < 2
+    constructor = @Data;
+end
+
+[values, labels, header] = readOpenSimTable(path);
+
+data = constructor();
+data.Values = values;
+data.Labels = labels;
+time = find(strcmpi(labels, 'time'), 1);
+data.isTimeSeries = ~isempty(time);
+if data.isTimeSeries
+    data.Timesteps = values(:, time);
+end
+data.Frames = size(values, 1);
+data.Header = header;
+data.hasHeader = true;
+data.isLabelled = true;
+
+end
@@ -0,0 +1,30 @@
+function mergeOpenSimTables(paths, output, keep)
+% Merges OpenSim tables covering consecutive time ranges in to one file.
+%   Paths is a cell array of .sto/.mot files with the same columns, e.g.
+%   the outputs of an analysis run in chunks, ordered by time. Table k
+%   contributes its rows from time keep(k) up to, but not including,
+%   keep(k + 1), and the last table its rows from keep(end) onwards. The
+%   header of the first table is kept. The merged table is written to
+%   output by writeOpenSimTable.
+
+tolerance = 1e-6;
+n_tables = length(paths);
+parts = cell(n_tables, 1);
+for k=1:n_tables
+    [values, table_labels, table_header] = readOpenSimTable(paths{k});
+    if k == 1
+        labels = table_labels;
+        header = table_header;
+    elseif ~isequal(table_labels, labels)
+        error('Columns of %s differ from those of %s.', paths{k}, paths{1});
+    end
+    time = values(:, strcmpi(labels, 'time'));
+    rows = time > keep(k) - tolerance;
+    if k < n_tables
+        rows = rows & time < keep(k + 1) - tolerance;
+    end
+    parts{k} = values(rows, :);
+end
+writeOpenSimTable(output, vertcat(parts{:}), labels, header);
+
+end
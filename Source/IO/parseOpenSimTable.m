@@ -0,0 +1,69 @@
+function [values, labels, header] = parseOpenSimTable(contents, path)
+% Parses the contents of an OpenSim .sto/.mot or .trc file.
+%   Contents is the text of the file, with any carriage returns removed.
+%   The path is used only to decide the file format and for error messages.
+%   See readOpenSimTable for a description of the outputs.
+%
+%   The numeric block is parsed by a single call to sscanf, which is much
+%   faster than parsing line by line. Files with empty fields, such as .trc
+%   files with marker gaps, fall back to textscan so that the gaps are read
+%   as NaN.
+
+% Parse the header and labels.
+[~, ~, ext] = fileparts(path);
+if strcmpi(ext, '.trc')
+    [labels, header, data_start] = parseTRCHeader(contents);
+else
+    [labels, header, data_start] = parseSTOHeader(contents, path);
+end
+
+% Parse the numeric block.
+block = contents(data_start:end);
+n_columns = length(labels);
+n_rows = length(regexp(block, '^\s*\S', 'lineanchors'));
+values = sscanf(block, '%f');
+if length(values) == n_rows*n_columns
+    values = reshape(values, n_columns, n_rows).';
+else
+    cells = textscan(block, [repmat('%f', 1, n_columns) '%*[^\n]'], ...
+        'Delimiter', '\t', 'EmptyValue', NaN, 'CollectOutput', true);
+    values = cells{1};
+end
+
+end
+
+function [labels, header, data_start] = parseSTOHeader(contents, path)
+% Header lines come before endheader, the labels on the line after it.
+
+header_end = regexp(contents, '^endheader', 'lineanchors', 'once');
+if isempty(header_end)
+    error('No endheader line found in %s.', path);
+end
+header = regexp(contents(1:header_end - 2), '\n', 'split');
+breaks = find(contents(header_end:end) == sprintf('\n'), 2) + header_end - 1;
+labels = strsplit(strtrim(contents(breaks(1) + 1:breaks(2) - 1)), ...
+    sprintf('\t'));
+data_start = breaks(2) + 1;
+
+end
+
+function [labels, header, data_start] = parseTRCHeader(contents)
+% Three header lines, then the marker names, then the co-ordinate names.
+
+breaks = find(contents == sprintf('\n'), 5);
+header = regexp(contents(1:breaks(3) - 1), '\n', 'split');
+fields = regexp(contents(breaks(3) + 1:breaks(4) - 1), '\t', 'split');
+markers = fields(3:end);
+markers = markers(~cellfun(@isempty, strtrim(markers)));
+n_markers = length(markers);
+labels = cell(1, 2 + 3*n_markers);
+labels(1:2) = fields(1:2);
+coordinates = {'X', 'Y', 'Z'};
+for i=1:n_markers
+    for j=1:3
+        labels{2 + 3*(i - 1) + j} = [strtrim(markers{i}) coordinates{j}];
+    end
+end
+data_start = breaks(5) + 1;
+
+end
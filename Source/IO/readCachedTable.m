@@ -0,0 +1,66 @@
+function [values, labels, header] = readCachedTable(...
+    path, cache, rotation, cutoff)
+% Reads an OpenSim table rotated in to the OpenSim frame, with caching.
+%   The table at path is read by readOpenSimTable and its vector
+%   quantities rotated by transformOpenSimTable. If a cutoff (Hz) is given
+%   every column after the time column is then low-pass filtered by
+%   zeroPhaseFilter, which filters around marker gaps. Centre of pressure
+%   columns, e.g. ground_force_px, are only filtered within each contact,
+%   i.e. while the magnitude of the matching force, e.g. ground_force_vx
+%   to vz, is over 1% of its peak, so that the jumps of the centre of
+%   pressure on and off the plate aren't smeared in to the contact. The
+%   result is saved to the MAT file cache, and later reads load it from
+%   there for as long as it is newer than the source file and was made
+%   with the same rotation and cutoff.
+
+if nargin < 4
+    cutoff = [];
+end
+
+if isUpToDate(cache, {path})
+    cached = load(cache);
+    if isequal(cached.rotation, rotation) && ...
+            isfield(cached, 'cutoff') && isequal(cached.cutoff, cutoff)
+        values = cached.values;
+        labels = cached.labels;
+        header = cached.header;
+        return;
+    end
+end
+
+[values, labels, header] = readOpenSimTable(path);
+values = transformOpenSimTable(values, labels, rotation);
+if ~isempty(cutoff)
+    time = find(strcmpi(labels, 'time'), 1);
+    if isempty(time)
+        error('%s has no time column, so it cannot be filtered.', path);
+    end
+    rate = 1/mean(diff(values(:, time)));
+    columns = time + 1:size(values, 2);
+    
+    % Mask the centre of pressure outside contact while filtering.
+    cop = ~cellfun(@isempty, regexp(labels, 'force_p[xyz]$', 'once'));
+    masked = false(size(values));
+    for column=find(cop)
+        components= find(~cellfun(@isempty, regexp(labels, ['^' ...
+            regexptranslate('escape', labels{column}(1:end - 2)) ...
+            'v[xyz]$'], 'once')));
+        if isempty(components)
+            continue;
+        end
+        magnitude = sqrt(sum(values(:, components).^2, 2));
+        masked(:, column) = ~(magnitude > 0.01*max(magnitude));
+    end
+    original = values(masked);
+    values(masked) = NaN;
+    values = zeroPhaseFilter(values, rate, cutoff, columns);
+    values(masked) = original;
+end
+
+folder = fileparts(cache);
+if exist(folder, 'dir') ~= 7
+    mkdir(folder);
+end
+save(cache, 'values', 'labels', 'header', 'rotation', 'cutoff');
+
+end
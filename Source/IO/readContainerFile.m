@@ -0,0 +1,12 @@
+function bytes = readContainerFile(container, key)
+% Reads the raw bytes of a file written by writeContainerFile.
+
+dataset = ['/' key '/raw'];
+n_bytes = double(h5readatt(container, dataset, 'size'));
+if n_bytes > 0
+    bytes = h5read(container, dataset).';
+else
+    bytes = zeros(1, 0, 'uint8');
+end
+
+end
@@ -0,0 +1,36 @@
+function [values, labels, header] = readContainerTable(container, key)
+% Reads a table written by writeContainerTable.
+%   Returns the same values, labels and header lines as readOpenSimTable
+%   would return for the original file. Tables which were stored as raw
+%   bytes by writeContainerFile are parsed from their text.
+
+group = h5info(container, ['/' key]);
+if ~any(strcmp({group.Datasets.Name}, 'values'))
+    contents = char(readContainerFile(container, key));
+    contents(contents == sprintf('\r')) = [];
+    [values, labels, header] = parseOpenSimTable(contents, key);
+    return;
+end
+
+dataset = ['/' key '/values'];
+table_size = double(h5readatt(container, dataset, 'size'));
+if all(table_size > 0)
+    values = h5read(container, dataset);
+else
+    values = zeros(table_size(:).');
+end
+labels = splitAttribute(h5readatt(container, dataset, 'labels'), '\t');
+header = splitAttribute(h5readatt(container, dataset, 'header'), '\n');
+
+end
+
+function list = splitAttribute(attribute, separator)
+% Split a '|' prefixed attribute back in to a cell array.
+
+if length(attribute) == 1
+    list = {};
+else
+    list = regexp(attribute(2:end), separator, 'split');
+end
+
+end
@@ -0,0 +1,34 @@
+function [values, labels, header] = readOpenSimTable(path)
+% Reads an OpenSim .sto/.mot or .trc file in a single call.
+%   Returns the data as a dense matrix with one column per label, the
+%   column labels as a cell array and the header lines as a cell array.
+%   For .sto/.mot files the header is everything before the endheader
+%   line. For .trc files it is the first three lines of the file, and the
+%   marker names are expanded to one label per co-ordinate, e.g. V_SacralX,
+%   V_SacralY, V_SacralZ.
+%
+%   The whole file is read in one go and then parsed by parseOpenSimTable.
+%
+%   If the file doesn't exist but has been packed in to an HDF5 container
+%   (see findContainer), the table is read from the container instead.
+
+% Read from a container if the file has been packed in to one.
+if exist(path, 'file') ~= 2
+    [container, key] = findContainer(path);
+    if ~isempty(container)
+        [values, labels, header] = readContainerTable(container, key);
+        return;
+    end
+end
+
+fid = fopen(path, 'r');
+if fid == -1
+    error('Unable to open %s.', path);
+end
+contents = fread(fid, [1, Inf], '*char');
+fclose(fid);
+contents(contents == sprintf('\r')) = [];
+
+[values, labels, header] = parseOpenSimTable(contents, path);
+
+end
@@ -0,0 +1,30 @@
+function restoreContainerFile(container, key, path)
+% Writes a file stored in an HDF5 container back to disk.
+%   Raw files are written back byte for byte. Tables are formatted with
+%   the precision they were stored with, if known, and with the default
+%   precision of their format otherwise.
+
+if exist(fileparts(path), 'dir') ~= 7
+    mkdir(fileparts(path));
+end
+
+group = h5info(container, ['/' key]);
+if any(strcmp({group.Datasets.Name}, 'raw'))
+    fid = fopen(path, 'w');
+    if fid == -1
+        error('Unable to open %s for writing.', path);
+    end
+    fwrite(fid, readContainerFile(container, key), 'uint8');
+    fclose(fid);
+else
+    dataset = group.Datasets(strcmp({group.Datasets.Name}, 'values'));
+    precision = [];
+    if any(strcmp({dataset.Attributes.Name}, 'precision'))
+        precision = double(h5readatt(container, ...
+            ['/' key '/values'], 'precision'));
+    end
+    [values, labels, header] = readContainerTable(container, key);
+    writeOpenSimTable(path, values, labels, header, precision);
+end
+
+end
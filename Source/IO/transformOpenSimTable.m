@@ -0,0 +1,44 @@
+function values = transformOpenSimTable(values, labels, rotation)
+% Rotates every vector quantity of an OpenSim table in one multiply.
+%   Vector quantities are identified from the labels as runs of three
+%   columns with a common prefix ending in X, Y, Z - marker positions as
+%   labelled by readOpenSimTable - or force_vx/y/z, force_px/y/z,
+%   torque_x/y/z or moment_x/y/z - forces, centres of pressure and torques,
+%   e.g. ground_force_vx or ground_torque_x. Other lower case triplets, such
+%   as the coordinates pelvis_tx/y/z, are not vectors in the lab frame and
+%   are left unchanged, as are all other columns. Each vector is
+%   premultiplied by the 3x3 rotation, e.g. the MarkerRotation or
+%   GRFRotation of a Dataset.
+%
+%   The rotations are assembled in to one sparse block diagonal matrix, so
+%   the whole table is transformed by a single matrix multiply.
+
+n_columns = size(values, 2);
+transform = speye(n_columns);
+c = 1;
+while c <= n_columns - 2
+    if isTriplet(labels(c:c + 2))
+        transform(c:c + 2, c:c + 2) = rotation.';
+        c = c + 3;
+    else
+        c = c + 1;
+    end
+end
+values = values*transform;
+
+end
+
+function result = isTriplet(labels)
+% True if three labels name the x, y and z components of one vector.
+
+if any(cellfun(@isempty, labels))
+    result = false;
+    return;
+end
+prefixes = cellfun(@(x) x(1:end - 1), labels, 'UniformOutput', false);
+suffixes = cellfun(@(x) x(end), labels);
+result = all(strcmp(prefixes, prefixes{1})) && ...
+    (strcmp(suffixes, 'XYZ') || (strcmp(suffixes, 'xyz') && ...
+    ~isempty(regexp(prefixes{1}, '(force_[vp]|torque_|moment_)$', 'once'))));
+
+end
@@ -0,0 +1,17 @@
+function writeContainerFile(container, key, bytes)
+% Writes the raw bytes of a file to a compressed HDF5 container.
+%   Used for files which aren't tables, or whose text can't be reproduced
+%   exactly from their parsed values. The bytes are stored as a deflated
+%   uint8 dataset named raw in the group named by key. See
+%   writeContainerTable for how keys are formed.
+
+dataset = ['/' key '/raw'];
+n_bytes = length(bytes);
+h5create(container, dataset, max(n_bytes, 1), 'Datatype', 'uint8', ...
+    'ChunkSize', min(max(n_bytes, 1), 1048576), 'Deflate', 4);
+if n_bytes > 0
+    h5write(container, dataset, bytes(:));
+end
+h5writeatt(container, dataset, 'size', n_bytes);
+
+end
@@ -0,0 +1,32 @@
+function writeContainerTable(container, key, values, labels, header, precision)
+% Writes a table to a chunked, compressed HDF5 container.
+%   The table is stored as a group named by key, which is the path of the
+%   original file relative to the folder the container was made from, with
+%   '/' as the separator. The values are a chunked double dataset, byte
+%   shuffled and then deflated - shuffling groups the similar exponent and
+%   high mantissa bytes of neighbouring values, which makes them compress
+%   far better. The labels and header lines are stored as tab and newline
+%   separated attributes, each prefixed by '|' so that empty lists can be
+%   stored. If given, the number of decimal places the file was written
+%   with is stored too, so it can be restored exactly. See
+%   readContainerTable for the inverse.
+
+group = ['/' key];
+[n_rows, n_columns] = size(values);
+dataset = [group '/values'];
+h5create(container, dataset, [max(n_rows, 1), max(n_columns, 1)], ...
+    'ChunkSize', [min(max(n_rows, 1), 4096), max(n_columns, 1)], ...
+    'Shuffle', true, 'Deflate', 4);
+if n_rows > 0 && n_columns > 0
+    h5write(container, dataset, values);
+end
+h5writeatt(container, dataset, 'size', [n_rows, n_columns]);
+h5writeatt(container, dataset, 'labels', ...
+    ['|' strjoin(labels, sprintf('\t'))]);
+h5writeatt(container, dataset, 'header', ...
+    ['|' strjoin(header, sprintf('\n'))]);
+if nargin == 6
+    h5writeatt(container, dataset, 'precision', precision);
+end
+
+end
@@ -0,0 +1,11 @@
+function writeData(data, path, precision)
+% Writes a Data object to a .sto/.mot file using writeOpenSimTable.
+%   A drop-in replacement for data.writeToFile(path, 1, 1).
+
+if nargin < 3
+    precision = 14;
+end
+
+writeOpenSimTable(path, data.Values, data.Labels, data.Header, precision);
+
+end
@@ -0,0 +1,34 @@
+function writeOpenSimTable(path, values, labels, header, precision)
+% Writes a dense matrix to an OpenSim .sto/.mot or .trc file in one call.
+%   The inverse of readOpenSimTable. The header is given as a cell array of
+%   lines - for .sto/.mot files without the endheader line, for .trc files
+%   the first three lines of the file. Row and column counts in the header
+%   are updated to match the values. Values are written tab separated with
+%   the given number of decimal places (default 14 for .sto/.mot and 6 for
+%   .trc), each line ending in a tab as in the files written by OpenSim. If
+%   a .sto/.mot header is empty a minimal one is created.
+%
+%   The file is formatted by formatOpenSimTable and written with a single
+%   fwrite to a temporary file in the same folder, which is then renamed
+%   over the target. Readers never see a partially written file.
+
+if nargin < 5
+    precision = [];
+end
+contents = formatOpenSimTable(path, values, labels, header, precision);
+
+% Write to a temporary file then rename it over the target.
+temp = [path '.' char(java.util.UUID.randomUUID()) '.tmp'];
+fid = fopen(temp, 'w');
+if fid == -1
+    error('Unable to open %s for writing.', temp);
+end
+fwrite(fid, contents, 'char');
+fclose(fid);
+[success, message] = movefile(temp, path, 'f');
+if ~success
+    delete(temp);
+    error('Unable to write %s: %s', path, message);
+end
+
+end
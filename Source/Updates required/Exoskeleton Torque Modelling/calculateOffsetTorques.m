@@ -13,13 +13,13 @@ offsets = calculateOffsets;
 offsets = offsets.s7;
 
 % Load in the original forces file and access the original APO torques.
-forces = Data('EA21.mot');
+forces = loadData('EA21.mot');
 right_apo_torque = forces.getDataCorrespondingToLabel('apo_torque_z');
 left_apo_torque = forces.getDataCorrespondingToLabel('1_apo_torque_z');
 
 % Load in the RRA-corrected kinematics and isolate the left and right hip
 % flexion joint angles. Simultaneously convert to radians. 
-kinematics = Data('RRA_q_1.sto');
+kinematics = loadData('RRA_q_1.sto');
 right_hip_angle = ...
     deg2rad(kinematics.getDataCorrespondingToLabel('hip_flexion_r'));
 left_hip_angle = ...
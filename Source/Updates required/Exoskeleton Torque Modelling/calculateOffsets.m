@@ -9,7 +9,7 @@ current_dir = pwd;
 cd([getenv('EXOPT_HOME') filesep 'Source\Scripts']);
 
 for subject = subjects
-    static = Data(['Static' num2str(subject) '.trc']);
+    static = loadData(['Static' num2str(subject) '.trc']);
     APO_x = static.getDataCorrespondingToLabel('V_SacralX') + x_offset;
     APO_y = static.getDataCorrespondingToLabel('V_SacralY') + y_offset;
     
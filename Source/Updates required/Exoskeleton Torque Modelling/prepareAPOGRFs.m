@@ -21,7 +21,7 @@ grf_struct = dir([grf_path filesep '*.mot']);
 
 for i=1:vectorSize(grf_struct)
     % Load in the right hip flexion joint angle trajectory. 
-    ik = Data([ik_path filesep ik_struct(i,1).name]);
+    ik = loadData([ik_path filesep ik_struct(i,1).name]);
     if subject == 8 && context == 8 && i == 4
         right_hip = ik.getDataCorrespondingToLabel('hip_flexion_r');
         right_hip = right_hip(1:round(length(right_hip)/2));
@@ -105,7 +105,7 @@ for i=1:vectorSize(grf_struct)
     % Write out the modified GRF file, for the moment this is just for
     % testing purposes. 
     new_grfs = grf + apo_data;
-    new_grfs.writeToFile([grf_path filesep grf_struct(i,1).name],1,1);
+    writeData(new_grfs, [grf_path filesep grf_struct(i,1).name]);
     
 end
 
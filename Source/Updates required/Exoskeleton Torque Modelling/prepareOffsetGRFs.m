@@ -25,8 +25,8 @@ grf_struct = dir([grf_path filesep '*.mot']);
 
 for i=1:length(grf_struct)
     % Load in the RRA hip joint angles and the GRFs. 
-    kinematics = Data([ik_path filesep ik_struct(i,1).name]);
-    forces = Data([grf_path filesep grf_struct(i,1).name]);
+    kinematics = loadData([ik_path filesep ik_struct(i,1).name]);
+    forces = loadData([grf_path filesep grf_struct(i,1).name]);
     
     % Get what we need.
     right_apo_torque = forces.getDataCorrespondingToLabel('apo_torque_z');
@@ -75,7 +75,7 @@ for i=1:length(grf_struct)
     forces.Values(1:end, 55) = -left_apo_torque; % torque to the APO. 
     
     % Rewrite these grfs. 
-    forces.writeToFile([grf_path filesep grf_struct(i,1).name], 1, 1);
+    writeData(forces, [grf_path filesep grf_struct(i,1).name]);
 end
 
 end
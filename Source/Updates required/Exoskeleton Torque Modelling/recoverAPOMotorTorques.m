@@ -86,8 +86,8 @@ spatial = model.calculateSpatialForcesFromTorqueTrajectory(t.');
 
 % Create a new external forces data object, and write it to file. 
 [ext, apo_only] = model.createExtForcesFileAPOSpecific(spatial);
-ext.writeToFile('grf_withAPO.mot',1,1);
-apo_only.writeToFile('grf_onlyAPO.mot',1,1);
+writeData(ext, 'grf_withAPO.mot');
+writeData(apo_only, 'grf_onlyAPO.mot');
 
 %% Set up input data aka taking the APO in to account. 
 % Construct an OpenSimTrial using the RRA-corrected kinematics from the
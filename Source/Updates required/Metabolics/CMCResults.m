@@ -21,11 +21,11 @@ classdef CMCResults
             if nargin > 0
                 
                 directory = getFullPath(directory);
-                obj.forces = Data([directory '_Actuation_force.sto']);
-                obj.powers = Data([directory '_Actuation_power.sto']);
+                obj.forces = loadData([directory '_Actuation_force.sto']);
+                obj.powers = loadData([directory '_Actuation_power.sto']);
                 obj.metabolics = ...
-					Data([directory '_MetabolicsReporter_probes.sto']);
-                obj.activations = Data([directory '_controls.sto']);
+					loadData([directory '_MetabolicsReporter_probes.sto']);
+                obj.activations = loadData([directory '_controls.sto']);
                 obj.start = obj.metabolics.Timesteps(1);
                 obj.final = obj.metabolics.Timesteps(end);
                 if nargin == 3
@@ -49,7 +49,7 @@ classdef CMCResults
                 filesep 'Model' filesep 'gait2392.osim']);
             for i=1:gait2392.getNumCoordinates()
                 joint = char(gait2392.getCoordinateSet().get(i-1));
-                obj.MomentArms.(joint) = Data([directory ...
+                obj.MomentArms.(joint) = loadData([directory ...
                     '_MuscleAnalysis_MomentArm_' joint '.sto']);
             end
         end
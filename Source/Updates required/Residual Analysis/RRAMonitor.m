@@ -0,0 +1,116 @@
+classdef RRAMonitor < handle
+    % Class for monitoring the residuals of an RRA which is still running.
+    %
+    % OpenSim only writes the RRA outputs once a run has finished, so a
+    % monitored RRA is run as a sequence of consecutive time chunks (see
+    % DatasetElement.runChunkedRRA), and the actuation force and pErr outputs
+    % of each chunk are checked as soon as it completes. Chunks may start
+    % early to let RRA settle, in which case only the rows from the start of
+    % the chunk proper are checked. The running maximum
+    % of each column is kept. The maximum over part of a run can only
+    % increase as the run continues, so the MAX metrics of RRAResiduals can
+    % be graded early - as soon as one of them is 'bad' the final grade of
+    % the run will be 'bad' too. RMS metrics are not graded, since their
+    % value over part of a run says nothing about the final value.
+    
+    properties (SetAccess = private)
+        Grade = 'unknown' % Becomes 'bad' once any MAX metric is bad.
+    end
+    
+    properties (SetAccess = private, GetAccess = private)
+        Forces % Running maxima of the actuation forces.
+        Errors % Running maxima of pErr.
+    end
+    
+    methods
+    
+        % Construct an RRAMonitor for a run which has not yet started.
+        function obj = RRAMonitor()
+            obj.Forces = RRAMonitor.createMaxima();
+            obj.Errors = RRAMonitor.createMaxima();
+        end
+        
+        function grade = check(obj, prefix, from)
+            % Add the outputs of a completed chunk and update the grade.
+            %   Prefix is the path prefix of the chunk's output files, as
+            %   for RRAResults. Optionally, only rows at or after the time
+            %   from are added.
+            if nargin < 3
+                from = -Inf;
+            end
+            obj.Forces = RRAMonitor.updateMaxima(obj.Forces, ...
+                [prefix '_Actuation_force.sto'], from);
+            obj.Errors = RRAMonitor.updateMaxima(obj.Errors, ...
+                [prefix '_pErr.sto'], from);
+            
+            % Forces and moments, metrics 1 and 3.
+            obj.gradeMax(1, obj.Forces, {'FX', 'FY', 'FZ'});
+            obj.gradeMax(3, obj.Forces, {'MX', 'MY', 'MZ'});
+            
+            % Translational and rotational pErr, metrics 5 and 7. Here, as
+            % in RRAResiduals, MTP and Subtalar are assumed locked.
+            translational = {'pelvis_tx', 'pelvis_ty', 'pelvis_tz'};
+            obj.gradeMax(5, obj.Errors, translational);
+            rotational = setdiff(obj.Errors.Labels, [translational, ...
+                {'time', 'mtp_angle_r', 'mtp_angle_l', ...
+                'subtalar_angle_r', 'subtalar_angle_l'}]);
+            obj.gradeMax(7, obj.Errors, rotational, 180/pi);
+            
+            grade = obj.Grade;
+        end
+    
+    end
+    
+    methods (Access = private)
+    
+        function gradeMax(obj, metric, maxima, labels, scale)
+            % Mark the run as bad if a MAX metric is already bad.
+            %   Labels missing from the outputs are skipped, and a metric
+            %   with none of its labels present is not graded. Optionally,
+            %   the maxima are scaled first, e.g. from radians to degrees.
+            values = maxima.Max(RRAMonitor.getColumns(maxima, labels));
+            if isempty(values)
+                return;
+            end
+            if nargin == 5
+                values = values*scale;
+            end
+            if strcmp(RRAResiduals.gradeValue(metric, max(values)), 'bad')
+                obj.Grade = 'bad';
+            end
+        end
+    
+    end
+    
+    methods (Static, Access = private)
+    
+        function maxima = createMaxima()
+            % Create the empty running maxima of an output file.
+            maxima.Labels = {};
+            maxima.Max = [];
+        end
+        
+        function maxima = updateMaxima(maxima, path, from)
+            % Update the running maxima with the rows of an output file
+            % from a given time.
+            [values, labels] = readOpenSimTable(path);
+            values = values(values(:, 1) >= from, :);
+            if isempty(maxima.Labels)
+                maxima.Labels = labels;
+                maxima.Max = zeros(1, length(labels));
+            elseif ~isequal(labels, maxima.Labels)
+                error('Columns of %s differ from earlier chunks.', path);
+            end
+            if ~isempty(values)
+                maxima.Max = max(maxima.Max, max(abs(values), [], 1));
+            end
+        end
+        
+        function columns = getColumns(maxima, labels)
+            % Indices of those of a cell array of labels which are present.
+            columns = find(ismember(maxima.Labels, labels));
+        end
+    
+    end
+
+end
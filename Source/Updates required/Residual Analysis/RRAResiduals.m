@@ -25,6 +25,16 @@ classdef RRAResiduals
         Grades 
     end
     
+    properties (Constant)
+        % Names of the residual metrics, in the order they are graded.
+        Metrics = {'MAX_Force', 'RMS_Force', 'MAX_Moment', 'RMS_Moment', ...
+            'MAX_pErr_T', 'RMS_pErr_T', 'MAX_pErr_R', 'RMS_pErr_R'}
+        
+        % Okay/bad thresholds of each metric, one row per metric.
+        Thresholds = [10 25; 5 10; 50 75; 30 75; ...
+            0.02 0.05; 0.02 0.05; 2 5; 2 5]
+    end
+    
     methods
         
         % Construct RRAResiduals object by analysing a given RRAResult.
@@ -34,144 +44,56 @@ classdef RRAResiduals
                 obj.Grades{8} = {};
                 
                 % Calculate residual metrics.
-                obj.MAX_Force = [...
-                    max(abs(RRAResult.forces.getDataCorrespondingToLabel('FX'))), ...
-                    max(abs(RRAResult.forces.getDataCorrespondingToLabel('FY'))), ...
-                    max(abs(RRAResult.forces.getDataCorrespondingToLabel('FZ')))];
-                obj.RMS_Force = [...
-                    rms(RRAResult.forces.getDataCorrespondingToLabel('FX')), ...
-                    rms(RRAResult.forces.getDataCorrespondingToLabel('FY')), ...
-                    rms(RRAResult.forces.getDataCorrespondingToLabel('FZ'))];
-                obj.MAX_Moment = [...
-                    max(abs(RRAResult.forces.getDataCorrespondingToLabel('MX'))), ...
-                    max(abs(RRAResult.forces.getDataCorrespondingToLabel('MY'))), ...
-                    max(abs(RRAResult.forces.getDataCorrespondingToLabel('MZ')))];
-                obj.RMS_Moment = [...
-                    rms(RRAResult.forces.getDataCorrespondingToLabel('MX')), ...
-                    rms(RRAResult.forces.getDataCorrespondingToLabel('MY')), ...
-                    rms(RRAResult.forces.getDataCorrespondingToLabel('Mz'))];
-                obj.MAX_pErr_T = [...
-                    max(abs(RRAResult.errors.getDataCorrespondingToLabel('pelvis_tx'))), ...
-                    max(abs(RRAResult.errors.getDataCorrespondingToLabel('pelvis_ty'))), ...
-                    max(abs(RRAResult.errors.getDataCorrespondingToLabel('pelvis_tz')))];
-                obj.RMS_pErr_T = [...
-                    rms(RRAResult.errors.getDataCorrespondingToLabel('pelvis_tx')), ...
-                    rms(RRAResult.errors.getDataCorrespondingToLabel('pelvis_ty')), ...
-                    rms(RRAResult.errors.getDataCorrespondingToLabel('pelvis_tz'))];
+                columns = RRAResiduals.getColumns(RRAResult.forces, ...
+                    {'FX', 'FY', 'FZ', 'MX', 'MY', 'MZ'});
+                [max_abs, rms_values] = RRAResiduals.columnStatistics(...
+                    RRAResult.forces.Values, columns);
+                obj.MAX_Force = max_abs(1:3);
+                obj.RMS_Force = rms_values(1:3);
+                obj.MAX_Moment = max_abs(4:6);
+                obj.RMS_Moment = rms_values(4:6);
+                columns = RRAResiduals.getColumns(RRAResult.errors, ...
+                    {'pelvis_tx', 'pelvis_ty', 'pelvis_tz'});
+                [obj.MAX_pErr_T, obj.RMS_pErr_T] = ...
+                    RRAResiduals.columnStatistics(...
+                    RRAResult.errors.Values, columns);
                 [obj, n] = obj.calculateRotational(RRAResult);
                 obj = obj.gradeResiduals(n);
             end
         end
         
         function [obj, n] = calculateRotational(obj,RRAResult)
-            % Initialise arrays -> n - 3 (for translation) - 1 (for time) - 4
-            % (for MTP and Subtalar coordinates). Here we're making the
-            % assumption that we've constrained the MTP and Subtalar joints
-            % to 0 during RRA - this is the default.
-            n = size(RRAResult.errors.Labels,2) - 8;
-            obj.MAX_pErr_R = zeros(1,n);
-            obj.RMS_pErr_R = zeros(1,n);
-            
-            % Create a copy of the error values. 
-            values = RRAResult.errors.Values;
-            
             % Obtain the indices we don't want to consider - time,
-            % translations, and MTP/Subtalar rotations. 
-            time = RRAResult.errors.getIndexCorrespondingToLabel('time');
-            px = RRAResult.errors.getIndexCorrespondingToLabel('pelvis_tx');
-            py = RRAResult.errors.getIndexCorrespondingToLabel('pelvis_ty');
-            pz = RRAResult.errors.getIndexCorrespondingToLabel('pelvis_tz');
-            mr = RRAResult.errors.getIndexCorrespondingToLabel('mtp_angle_r');
-            ml = RRAResult.errors.getIndexCorrespondingToLabel('mtp_angle_l');
-            sr = RRAResult.errors.getIndexCorrespondingToLabel('subtalar_angle_r');
-            sl = RRAResult.errors.getIndexCorrespondingToLabel('subtalar_angle_l');
-            
-            % Sort these indices in ascending order.
-            indices_to_remove = sort([time,px,py,pz,mr,ml,sr,sl],'descend');
-            
-            % Remove these entries from values.
-            for i=1:8
-                values(:,indices_to_remove(i)) = [];
-            end
+            % translations, and MTP/Subtalar rotations. Here we're making
+            % the assumption that we've constrained the MTP and Subtalar
+            % joints to 0 during RRA - this is the default.
+            excluded = RRAResiduals.getColumns(RRAResult.errors, ...
+                {'time', 'pelvis_tx', 'pelvis_ty', 'pelvis_tz', ...
+                'mtp_angle_r', 'mtp_angle_l', 'subtalar_angle_r', ...
+                'subtalar_angle_l'});
+            columns = setdiff(1:size(RRAResult.errors.Labels, 2), excluded);
+            n = length(columns);
             
             % Calculate the MAX and RMS errors for the relevant values. 
-            obj.MAX_pErr_R(1:end) = rad2deg(max(abs(values(:,1:end))));
-            obj.RMS_pErr_R(1:end) = rad2deg(rms(values(:,1:end)));
+            [max_abs, rms_values] = RRAResiduals.columnStatistics(...
+                RRAResult.errors.Values, columns);
+            obj.MAX_pErr_R = rad2deg(max_abs);
+            obj.RMS_pErr_R = rad2deg(rms_values);
         end
         
         function obj = gradeResiduals(obj, n)
-            % 3D metrics. 
-            for i=1:3
-                % Classify metrics as 'bad' or 'okay'. 
-                if obj.MAX_Force(i) > 25
-                    obj.Grades{1} = 'bad';
-                elseif isempty(obj.Grades{1}) && obj.MAX_Force(i) > 10
-                    obj.Grades{1} = 'okay';
-                end
-                
-                if obj.RMS_Force(i) > 10
-                    obj.Grades{2} = 'bad';
-                elseif isempty(obj.Grades{2}) && obj.RMS_Force(i) > 5
-                    obj.Grades{2} = 'okay';
-                end
-                
-                if obj.MAX_Moment(i) > 75
-                    obj.Grades{3} = 'bad';
-                elseif isempty(obj.Grades{3}) && obj.MAX_Moment(i) > 50
-                    obj.Grades{3} = 'okay';
-                end
-                
-                if obj.RMS_Moment(i) > 75
-                    obj.Grades{4} = 'bad';
-                elseif isempty(obj.Grades{4}) && obj.RMS_Moment(i) > 30
-                    obj.Grades{4} = 'okay';
-                end
-                
-                if obj.MAX_pErr_T(i) > 0.05
-                    obj.Grades{5} = 'bad';
-                elseif isempty(obj.Grades{4}) && obj.MAX_pErr_T(i) > 0.02
-                    obj.Grades{5} = 'okay';
-                end
-                
-                if obj.RMS_pErr_T(i) > 0.05
-                    obj.Grades{6} = 'bad';
-                elseif isempty(obj.Grades{6}) && obj.RMS_pErr_T(i) > 0.02
-                    obj.Grades{6} = 'okay';
-                end
-                
-                % If a metric is unclassified by the end then classify it
-                % as 'good'.
-                if i == 3
-                    for j=1:6
-                        if isempty(obj.Grades{j})
-                            obj.Grades{j} = 'good';
-                        end
-                    end
-                end
-                
+            % Grade each metric by the worst of its components. A metric is
+            % 'bad' or 'okay' if any component exceeds the corresponding
+            % threshold, and 'good' otherwise. If there are no rotational
+            % coordinates (n is 0) the rotational pErr metrics are left
+            % ungraded.
+            n_metrics = length(RRAResiduals.Metrics);
+            if n == 0
+                n_metrics = 6;
             end
-            
-            % Rotational errors. 
-            for i=1:n
-                if obj.MAX_pErr_R(i) > 5
-                    obj.Grades{7} = 'bad';
-                elseif isempty(obj.Grades{7}) && obj.MAX_pErr_R(i) > 2
-                    obj.Grades{7} = 'okay';
-                end
-                
-                if obj.RMS_pErr_R(i) > 5
-                    obj.Grades{8} = 'bad';
-                elseif isempty(obj.Grades{8}) && obj.RMS_pErr_R(i) > 2
-                    obj.Grades{8} = 'okay';
-                end
-                
-                if i == n
-                    for j=7:8
-                        if isempty(obj.Grades{j})
-                            obj.Grades{j} = 'good';
-                        end
-                    end
-                end
+            for i=1:n_metrics
+                obj.Grades{i} = RRAResiduals.gradeValue(...
+                    i, max(obj.(RRAResiduals.Metrics{i})));
             end
         end
         
@@ -198,5 +120,39 @@ classdef RRAResiduals
         
     end
     
+    methods (Static)
+        
+        function [max_abs, rms_values] = columnStatistics(values, columns)
+            % Max-abs and RMS of a set of columns of a data matrix.
+            %   The requested columns are gathered once and both statistics
+            %   are computed over that block, rather than searching for and
+            %   copying each column separately for every statistic. Columns
+            %   are given as a vector of indices in to values.
+            block = values(:, columns);
+            max_abs = max(abs(block), [], 1);
+            rms_values = sqrt(sum(block.^2, 1)/size(block, 1));
+        end
+        
+        function grade = gradeValue(metric, value)
+            % Grade a single value of the metric with the given index.
+            if value > RRAResiduals.Thresholds(metric, 2)
+                grade = 'bad';
+            elseif value > RRAResiduals.Thresholds(metric, 1)
+                grade = 'okay';
+            else
+                grade = 'good';
+            end
+        end
+        
+        function columns = getColumns(data, labels)
+            % Indices of a cell array of labels within a data object. 
+            columns = zeros(1, length(labels));
+            for i=1:length(labels)
+                columns(i) = data.getIndexCorrespondingToLabel(labels{i});
+            end
+        end
+        
+    end
+    
 end
 
@@ -28,6 +28,8 @@ classdef RRAResults
     properties (SetAccess = private, GetAccess = private)
         Adjustment = false
         AdjustedModel = 'N/A'
+        marker_path % Sidecar file recording that the outputs are normalised.
+        cache_path % Binary cache of the normalised RRAData objects.
     end
     
     methods
@@ -53,19 +55,22 @@ classdef RRAResults
                     [directory '_pErr.sto'];
                 obj.states_path = ...
                     [directory '_states.sto'];
-                obj.forces = RRAData(obj.forces_path);
-                obj.accelerations = RRAData(obj.accelerations_path);
-                obj.velocities = RRAData(obj.velocities_path);
-                obj.positions = RRAData(obj.positions_path);
-                obj.errors = RRAData(obj.errors_path);
-                obj.states = RRAData(obj.states_path);
+                obj.marker_path = [directory '_normalised.txt'];
+                obj.cache_path = [directory '_cache.mat'];
+                
+                % Intermediate timestep removal only needs to be written
+                % back to file once. After that the outputs are treated as
+                % read-only, and are loaded from the binary cache if it
+                % is still up to date.
+                if obj.isNormalised()
+                    obj = obj.loadNormalised();
+                else
+                    obj = obj.loadRaw();
+                    obj.normalise();
+                end
                 obj.start = obj.forces.Timesteps(1);
                 obj.final = obj.forces.Timesteps(end);
                 
-                % Rewrite RRA data files to account for intermediate
-                % timestep removal.
-                obj.rewriteRRA();
-                
                 % Analyse the RRA residuals.
                 obj = obj.analyseResiduals();
             end
@@ -81,12 +86,45 @@ classdef RRAResults
             % to make it an intrinsic part of getting RRA data - the
             % intermediate timesteps are removed, and the files are
             % reprinted. 
-            obj.forces.writeToFile(obj.forces_path,1,1);
-            obj.accelerations.writeToFile(obj.accelerations_path,1,1);
-            obj.velocities.writeToFile(obj.velocities_path,1,1);
-            obj.positions.writeToFile(obj.positions_path,1,1);
-            obj.errors.writeToFile(obj.errors_path,1,1);
-            obj.states.writeToFile(obj.states_path,1,1);
+            writeData(obj.forces, obj.forces_path);
+            writeData(obj.accelerations, obj.accelerations_path);
+            writeData(obj.velocities, obj.velocities_path);
+            writeData(obj.positions, obj.positions_path);
+            writeData(obj.errors, obj.errors_path);
+            writeData(obj.states, obj.states_path);
+        end
+        
+        function normalise(obj)
+            % Perform the one-off post-processing of the RRA outputs.
+            %   The files are rewritten with the intermediate timesteps
+            %   removed, a binary cache of the resulting RRAData objects is
+            %   saved, and finally the sidecar marker is written. The marker
+            %   is written last so that an interrupted normalisation is
+            %   simply repeated the next time the results are opened.
+            %
+            %   Every file is written to a temporary file and renamed over
+            %   the target, as by writeOpenSimTable, so that concurrent
+            %   first-time constructions never see a partial cache or
+            %   marker. Each writes the same contents, so the last rename
+            %   wins harmlessly.
+            obj.rewriteRRA();
+            data.forces = obj.forces;
+            data.accelerations = obj.accelerations;
+            data.velocities = obj.velocities;
+            data.positions = obj.positions;
+            data.errors = obj.errors;
+            data.states = obj.states;
+            temp = RRAResults.getTempPath(obj.cache_path);
+            save(temp, '-struct', 'data');
+            RRAResults.replaceFile(temp, obj.cache_path);
+            temp = RRAResults.getTempPath(obj.marker_path);
+            fid = fopen(temp, 'w');
+            if fid == -1
+                error('Unable to open %s for writing.', temp);
+            end
+            fprintf(fid, 'Normalised %s\n', datestr(now, 30));
+            fclose(fid);
+            RRAResults.replaceFile(temp, obj.marker_path);
         end
         
         function model = getAdjustedModel(obj)
@@ -107,5 +145,78 @@ classdef RRAResults
         
     end
     
+    methods (Access = private)
+        
+        function paths = getDataPaths(obj)
+            % Paths to the six RRA output files.
+            paths = {obj.forces_path, obj.accelerations_path, ...
+                obj.velocities_path, obj.positions_path, ...
+                obj.errors_path, obj.states_path};
+        end
+        
+        function result = isNormalised(obj)
+            % True if the marker exists and no output is newer than it.
+            %   Re-running RRA overwrites the outputs, which invalidates the
+            %   marker and causes the outputs to be normalised again.
+            result = isUpToDate(obj.marker_path, obj.getDataPaths());
+        end
+        
+        function obj = loadRaw(obj)
+            % Read the outputs, removing intermediate RRA timesteps.
+            obj.forces = RRAData(obj.forces_path);
+            obj.accelerations = RRAData(obj.accelerations_path);
+            obj.velocities = RRAData(obj.velocities_path);
+            obj.positions = RRAData(obj.positions_path);
+            obj.errors = RRAData(obj.errors_path);
+            obj.states = RRAData(obj.states_path);
+        end
+        
+        function obj = loadNormalised(obj)
+            % Read already normalised outputs without writing anything.
+            %   Without an up to date cache the files are read by the fast
+            %   loadData, since their intermediate timesteps have already
+            %   been removed.
+            if isUpToDate(obj.cache_path, obj.getDataPaths())
+                data = load(obj.cache_path);
+                obj.forces = data.forces;
+                obj.accelerations = data.accelerations;
+                obj.velocities = data.velocities;
+                obj.positions = data.positions;
+                obj.errors = data.errors;
+                obj.states = data.states;
+            else
+                obj.forces = loadData(obj.forces_path, @RRAData);
+                obj.accelerations = ...
+                    loadData(obj.accelerations_path, @RRAData);
+                obj.velocities = loadData(obj.velocities_path, @RRAData);
+                obj.positions = loadData(obj.positions_path, @RRAData);
+                obj.errors = loadData(obj.errors_path, @RRAData);
+                obj.states = loadData(obj.states_path, @RRAData);
+            end
+        end
+        
+    end
+    
+    methods (Static, Access = private)
+        
+        function temp = getTempPath(path)
+            % Unique temporary file in the same folder as a target file.
+            %   The extension is kept so that save writes a MAT file.
+            [folder, name, ext] = fileparts(path);
+            temp = [folder filesep name '.' ...
+                char(java.util.UUID.randomUUID()) '.tmp' ext];
+        end
+        
+        function replaceFile(temp, path)
+            % Rename a temporary file over its target.
+            [success, message] = movefile(temp, path, 'f');
+            if ~success
+                delete(temp);
+                error('Unable to write %s: %s', path, message);
+            end
+        end
+        
+    end
+    
 end
 
@@ -0,0 +1,107 @@
+function [labels, centres, cost] = clusterCycles(features, k, method, ...
+    varargin)
+% Clusters cycles in to k groups by their patterns.
+%   Features is an n x d matrix with one row per cycle, e.g. normalised
+%   trajectories laid end to end. Method is one of
+%
+%       'kmeans' - k-means, by kmeans
+%       'kmedoids' - k-medoids, by kmedoids, less sensitive to outliers
+%       'minibatch' - mini-batch k-means, for very large numbers of cycles
+%
+%   Each method is restarted from several random initialisations, in
+%   parallel, and the result of lowest cost kept. Returns the cluster label
+%   of each cycle, the k x d cluster centres and the total within-cluster
+%   cost (sum of squared distances for k-means, distances for k-medoids).
+%
+%   Options are given as name-value pairs:
+%
+%       Replicates - number of restarts, default 10
+%       Seed - seed of the random streams, default 0, which with the
+%           number of replicates fixes the result whatever the pool size
+%       BatchSize - cycles per mini-batch, default 1024
+%       Iterations - mini-batch iterations, default 100
+
+replicates = 10;
+seed = 0;
+batch_size = 1024;
+iterations = 100;
+for i=1:2:length(varargin)
+    switch varargin{i}
+        case 'Replicates'
+            replicates = varargin{i + 1};
+        case 'Seed'
+            seed = varargin{i + 1};
+        case 'BatchSize'
+            batch_size = varargin{i + 1};
+        case 'Iterations'
+            iterations = varargin{i + 1};
+        otherwise
+            error('Unrecognised option %s.', varargin{i});
+    end
+end
+
+switch method
+    case {'kmeans', 'kmedoids'}
+        options = statset('UseParallel', true, 'UseSubstreams', true, ...
+            'Streams', RandStream('mlfg6331_64', 'Seed', seed));
+        cluster = str2func(method);
+        [labels, centres, sums] = cluster(features, k, ...
+            'Replicates', replicates, 'Options', options);
+        cost = sum(sums);
+    case 'minibatch'
+        results = cell(replicates, 1);
+        costs = zeros(replicates, 1);
+        parfor r=1:replicates
+            stream = RandStream('mlfg6331_64', 'Seed', seed);
+            stream.Substream = r;
+            result = miniBatchKMeans(features, k, batch_size, ...
+                iterations, stream);
+            [~, distances] = assignClusters(features, result);
+            results{r} = result;
+            costs(r) = sum(distances);
+        end
+        [cost, best] = min(costs);
+        centres = results{best};
+        labels = assignClusters(features, centres);
+    otherwise
+        error('Unrecognised clustering method %s.', method);
+end
+
+end
+
+function centres = miniBatchKMeans(features, k, batch_size, iterations, ...
+    stream)
+% Mini-batch k-means (Sculley, 2010).
+%   Each iteration assigns a random batch of cycles to their nearest
+%   centres, then moves each centre towards the mean of its batch members
+%   with a step size of 1/(number of cycles assigned to it so far).
+
+n = size(features, 1);
+centres = features(randperm(stream, n, k), :);
+counts = zeros(k, 1);
+batch_size = min(batch_size, n);
+for iteration=1:iterations
+    batch = features(randperm(stream, n, batch_size), :);
+    labels = assignClusters(batch, centres);
+    for j=1:k
+        members = labels == j;
+        n_members = nnz(members);
+        if n_members > 0
+            counts(j) = counts(j) + n_members;
+            centres(j, :) = centres(j, :) + (sum(batch(members, :), 1) ...
+                - n_members*centres(j, :))/counts(j);
+        end
+    end
+end
+
+end
+
+function [labels, distances] = assignClusters(features, centres)
+% Nearest centre of each cycle and the squared distance to it.
+
+distances = sum(features.^2, 2) - 2*features*centres.' + ...
+    sum(centres.^2, 2).';
+[distances, labels] = min(distances, [], 2);
+distances = max(distances, 0);
+
+end
@@ -0,0 +1,96 @@
+function events = detectGaitEvents(forces, force_labels, markers, ...
+    marker_labels, thresholds, plates)
+% Detects the heel strikes and toe offs of both feet in a trial.
+%   Forces and markers are tables in the OpenSim frame (x forwards, y
+%   upwards), as returned by the loadForces and loadMarkers methods of
+%   DatasetElement. Contact is detected from the vertical GRF of each foot.
+%   Plates gives the prefixes of the force columns under the right and
+%   left foot, by default {'ground_force', '1_ground_force'}, i.e. the
+%   first ground force (ground_force_vy) is under the right foot and the
+%   second (1_ground_force_vy) under the left. The threshold
+%   has hysteresis: contact begins when the force rises above
+%   thresholds(1) and ends when it falls below thresholds(2) (default
+%   [50 20] N). Both feet are processed at once, without a loop over
+%   frames.
+%
+%   If either vertical force is missing, or a foot never makes contact,
+%   events are instead found from the markers by the method of Zeni et al.
+%   (2008): heel strikes at the maxima of the forward position of the heel
+%   (R_Heel, L_Heel) relative to the sacrum (V_Sacral), and toe offs at the
+%   minima of that of the first metatarsal head (R_MTP1, L_MTP1). The
+%   positions are first smoothed at 6 Hz, and events of the same kind on
+%   the same foot must be at least 0.5 s apart, less than any walking or
+%   running stride, so that marker noise doesn't give spurious events.
+%
+%   Returns a struct with the Source of the events, 'GRF' or 'Markers', and
+%   for each of Right and Left the sorted HeelStrike and ToeOff times.
+
+if nargin < 6
+    plates = {'ground_force', '1_ground_force'};
+end
+if nargin < 5 || isempty(thresholds)
+    thresholds = [50 20];
+end
+feet = {'Right', 'Left'};
+
+% Detect contact from the vertical GRFs.
+vertical = [find(strcmp(force_labels, [plates{1} '_vy'])), ...
+    find(strcmp(force_labels, [plates{2} '_vy']))];
+if length(vertical) == 2
+    time = forces(:, strcmpi(force_labels, 'time'));
+    changes = diff(hysteresis(forces(:, vertical), thresholds(1), ...
+        thresholds(2)));
+    if all(any(changes == 1, 1))
+        events.Source = 'GRF';
+        for foot=1:2
+            events.(feet{foot}).HeelStrike = ...
+                time(find(changes(:, foot) == 1) + 1);
+            events.(feet{foot}).ToeOff = ...
+                time(find(changes(:, foot) == -1) + 1);
+        end
+        return;
+    end
+end
+
+% Otherwise detect events from the heel and toe markers.
+time = markers(:, strcmpi(marker_labels, 'time'));
+sacrum = markers(:, strcmp(marker_labels, 'V_SacralX'));
+heels = markers(:, [find(strcmp(marker_labels, 'R_HeelX')), ...
+    find(strcmp(marker_labels, 'L_HeelX'))]) - sacrum;
+toes = markers(:, [find(strcmp(marker_labels, 'R_MTP1X')), ...
+    find(strcmp(marker_labels, 'L_MTP1X'))]) - sacrum;
+if isempty(sacrum) || size(heels, 2) ~= 2 || size(toes, 2) ~= 2
+    error('Gait events need vertical GRFs or heel, toe and sacrum markers.');
+end
+rate = 1/mean(diff(time));
+heels = zeroPhaseFilter(heels, rate, 6);
+toes = zeroPhaseFilter(toes, rate, 6);
+events.Source = 'Markers';
+for foot=1:2
+    [~, strikes] = findpeaks(heels(:, foot), time, ...
+        'MinPeakDistance', 0.5);
+    [~, offs] = findpeaks(-toes(:, foot), time, 'MinPeakDistance', 0.5);
+    events.(feet{foot}).HeelStrike = strikes(:);
+    events.(feet{foot}).ToeOff = offs(:);
+end
+
+end
+
+function contact = hysteresis(signal, on, off)
+% Contact state of each column of a signal, with hysteresis.
+%   Samples above on are in contact and samples below off are not. Samples
+%   in between take the state of the last sample outside that band, found
+%   for every sample at once with a cumulative maximum of indices.
+
+[n_frames, n_columns] = size(signal);
+state = NaN(n_frames, n_columns);
+state(signal > on) = 1;
+state(signal < off) = 0;
+known = repmat((1:n_frames).', 1, n_columns).*~isnan(state);
+last = cummax(known, 1);
+contact = zeros(n_frames, n_columns);
+valid = last > 0;
+offsets = repmat(n_frames*(0:n_columns - 1), n_frames, 1);
+contact(valid) = state(last(valid) + offsets(valid));
+
+end
@@ -0,0 +1,17 @@
+function result = isUpToDate(path, sources)
+% Checks whether a derived file is at least as new as its source files.
+%   Returns true if the file at path exists and no file in the cell array
+%   sources is newer than it. Missing source files also cause false to be
+%   returned, so that anything derived from them is regenerated.
+
+info = dir(path);
+result = ~isempty(info);
+for i=1:length(sources)
+    if ~result
+        return;
+    end
+    source = dir(sources{i});
+    result = ~isempty(source) && source.datenum <= info.datenum;
+end
+
+end
@@ -0,0 +1,73 @@
+function [warped, paths, template] = registerCycles(cycles, template, ...
+    band, iterations)
+% Registers gait cycles to a template by dynamic time warping.
+%   Cycles is an n x samples x channels array of time-normalised cycles,
+%   e.g. from a NormalisedCycleStore. Each cycle is aligned to the template
+%   (samples x channels) by DTW over all its channels at once, with the
+%   warping path constrained to a band of band samples either side of the
+%   diagonal (default 10% of the cycle). The DTW itself is the compiled dtw
+%   of the Signal Processing Toolbox, and cycles are aligned in parallel.
+%   Channels are z-scored, by their mean and standard deviation over all
+%   cycles, before the DTW, so that channels in large units, e.g. moments
+%   in Nm next to angles in radians, don't dominate the alignment. The
+%   unscaled cycles are then warped along the paths found.
+%
+%   Warped is the array of cycles resampled on to the time base of the
+%   template, each template sample taking the mean of the cycle samples
+%   matched to it, so peaks are aligned rather than blurred when averaged.
+%   Paths is an n x 1 cell array of the [cycle, template] sample index
+%   pairs of each warping path.
+%
+%   If the template is empty the mean cycle is used, and refined by
+%   re-registering to the mean of the warped cycles for the given number of
+%   iterations (default 3). The final template is returned.
+
+[n_cycles, n_samples, n_channels] = size(cycles);
+if nargin < 4
+    iterations = 3;
+end
+if nargin < 3 || isempty(band)
+    band = round(0.1*n_samples);
+end
+refine = nargin < 2 || isempty(template);
+if refine
+    template = reshape(mean(cycles, 1), n_samples, n_channels);
+else
+    iterations = 1;
+end
+
+% Scale of each channel for the DTW.
+flat = reshape(cycles, [], n_channels);
+centre = mean(flat, 1);
+scale = std(flat, 0, 1);
+scale(scale == 0) = 1;
+
+for iteration=1:iterations
+    warped = zeros(n_cycles, n_samples, n_channels);
+    paths = cell(n_cycles, 1);
+    target = ((template - centre)./scale).';
+    parfor i=1:n_cycles
+        cycle = reshape(cycles(i, :, :), n_samples, n_channels);
+        [~, from, to] = dtw(((cycle - centre)./scale).', target, band);
+        paths{i} = [from(:), to(:)];
+        warped(i, :, :) = warpCycle(cycle, from, to, n_samples);
+    end
+    if refine
+        template = reshape(mean(warped, 1), n_samples, n_channels);
+    end
+end
+
+end
+
+function warped = warpCycle(cycle, from, to, n_samples)
+% Resample a cycle on to the template time base along a warping path.
+
+n_channels = size(cycle, 2);
+warped = zeros(n_samples, n_channels);
+counts = accumarray(to(:), 1, [n_samples, 1]);
+for channel=1:n_channels
+    warped(:, channel) = accumarray(to(:), cycle(from, channel), ...
+        [n_samples, 1])./counts;
+end
+
+end
@@ -0,0 +1,46 @@
+function [scores, channels] = robustCycleScores(values, labels)
+% Scores how far each of a group of cycles deviates from the others.
+%   Values is a struct of cycles x samples x channels arrays, e.g. the IK
+%   and ID tables of the normalised cycles of one subject and context, and
+%   labels a struct of the channel labels of each table. At every sample
+%   of every channel the cycles are given robust z scores, relative to the
+%   median and scaled median absolute deviation (MAD) across cycles, so
+%   that the statistics are not themselves skewed by the outliers being
+%   looked for. Each channel of a cycle is scored by the root mean square
+%   of its z scores over the samples, which is around 1 for typical cycles
+%   whatever the units of the channel, and the score of the cycle is that
+%   of its worst channel. A fault in a single channel, e.g. a swapped
+%   marker, is then not diluted by the many channels which are normal.
+%   Channels gives the table and label of the worst channel of each
+%   cycle, e.g. 'IK/hip_flexion_r'.
+%
+%   Channels which are constant across cycles are ignored. At least three
+%   cycles are needed for the median and MAD to be meaningful, otherwise
+%   every score is NaN and every channel empty.
+
+tables = fieldnames(values);
+n_cycles = size(values.(tables{1}), 1);
+scores = NaN(n_cycles, 1);
+channels = repmat({''}, n_cycles, 1);
+if n_cycles < 3
+    return;
+end
+
+for i=1:length(tables)
+    data = values.(tables{i});
+    centre = median(data, 1);
+    scale = 1.4826*median(abs(data - centre), 1);
+    varying = scale > 0 & all(isfinite(data), 1);
+    z = (data - centre)./scale;
+    z(:, ~varying) = 0;
+    n_varying = reshape(sum(varying, 2), 1, []);
+    rms = sqrt(reshape(sum(z.^2, 2), n_cycles, [])./n_varying);
+    rms(:, n_varying == 0) = NaN;
+    [worst, column] = max(rms, [], 2);
+    better = worst > scores | (isnan(scores) & ~isnan(worst));
+    scores(better) = worst(better);
+    channels(better) = strcat(tables{i}, '/', ...
+        labels.(tables{i})(column(better)));
+end
+
+end
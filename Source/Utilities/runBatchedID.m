@@ -0,0 +1,106 @@
+function [results, labels] = runBatchedID(model, kinematics, loads, grfs, ...
+    outputs, settings)
+% Inverse dynamics of one set of kinematics under several external loads.
+%   Computes the generalised forces of the model for each frame of the
+%   kinematics file, once for each external load variant. Variant i
+%   applies the ExternalLoads file loads{i} to the GRF data file grfs{i},
+%   and its results are written to outputs{i} in the format of the ID tool
+%   (moments and forces labelled e.g. hip_flexion_r_moment). Also returns
+%   the results as a cell array of matrices, one per variant, with the
+%   matching labels.
+%
+%   The kinematics are evaluated once, on the client, as by the ID tool
+%   with the setup file settings, see ToolPool.evaluateKinematics, along
+%   with the kinematics locating the loads of each distinct lowpass_cutoff_
+%   frequency_for_load_kinematics of the variants. Frames have no
+%   dependence on each other, so the evaluated frames are split in to one
+%   block per parallel worker, and each worker solves its block under
+%   every variant using the models of its ToolPool, see ToolPool.solveID,
+%   which are kept between calls with only their GRF data swapped.
+%
+%   Muscles are excluded, as by the default ID tool settings. The model
+%   coordinates are assumed to be in the same order as its generalised
+%   speeds, as for the tree-structured gait models used here.
+
+import org.opensim.modeling.*
+
+% Evaluate the kinematics, and those locating the loads of each variant.
+tool = InverseDynamicsTool(settings, false);
+n_variants = length(loads);
+load_cutoffs = zeros(1, n_variants);
+for i=1:n_variants
+    external = ExternalLoads(loads{i}, true);
+    load_cutoffs(i) = external.getLowpassCutoffFrequencyForLoadKinematics();
+end
+motion = ToolPool.evaluateKinematics(kinematics, ...
+    tool.getLowpassCutoffFrequency(), load_cutoffs(1));
+[values, labels] = readOpenSimTable(kinematics);
+load_q = cell(1, n_variants);
+for i=1:n_variants
+    match = find(load_cutoffs(1:i) == load_cutoffs(i), 1);
+    if match == 1
+        load_q{i} = motion.LoadQ;
+    elseif match < i
+        load_q{i} = load_q{match};
+    else
+        load_q{i} = ToolPool.filterLoadKinematics(values, labels, ...
+            motion.Labels, load_cutoffs(i));
+    end
+end
+
+% Solve blocks of frames across the pool.
+n_frames = length(motion.Time);
+pool = gcp();
+n_blocks = min(pool.NumWorkers, n_frames);
+edges = round(linspace(0, n_frames, n_blocks + 1));
+blocks = cell(n_blocks, 1);
+for k=1:n_blocks
+    frames = edges(k) + 1:edges(k + 1);
+    blocks{k}.Motion = sliceMotion(motion, frames);
+    blocks{k}.LoadQ = cellfun(@(x) x(frames, :), load_q, ...
+        'UniformOutput', false);
+end
+forces = cell(n_blocks, 1);
+block_labels = cell(n_blocks, 1);
+parfor k=1:n_blocks
+    [forces{k}, block_labels{k}] = solveBlock(model, settings, loads, ...
+        grfs, blocks{k});
+end
+labels = block_labels{1};
+
+% Gather and write the results of each variant.
+results = cell(1, n_variants);
+for i=1:n_variants
+    results{i} = [motion.Time, cell2mat(cellfun(@(x) x{i}, forces, ...
+        'UniformOutput', false))];
+    writeOpenSimTable(outputs{i}, results{i}, labels, ...
+        {'Inverse Dynamics Generalized Forces', 'version=1', 'nRows=', ...
+        'nColumns=', 'inDegrees=no'});
+end
+
+end
+
+function motion = sliceMotion(motion, frames)
+% Select frames of evaluated kinematics.
+
+fields = {'Time', 'Q', 'U', 'UDot', 'LoadQ'};
+for i=1:length(fields)
+    motion.(fields{i}) = motion.(fields{i})(frames, :);
+end
+
+end
+
+function [forces, labels] = solveBlock(model, settings, loads, grfs, block)
+% Solve inverse dynamics for a block of frames under each variant.
+
+pool = ToolPool.getPool();
+n_variants = length(loads);
+forces = cell(1, n_variants);
+motion = block.Motion;
+for i=1:n_variants
+    motion.LoadQ = block.LoadQ{i};
+    [forces{i}, labels] = pool.solveID(model, settings, loads{i}, ...
+        grfs{i}, motion);
+end
+
+end
@@ -0,0 +1,54 @@
+function values = zeroPhaseFilter(values, rate, cutoff, columns)
+% Low-pass filters the columns of a matrix without phase lag.
+%   Applies a 2nd order Butterworth filter forwards and backwards, i.e. a
+%   4th order zero-lag filter, with the given cutoff (Hz) to data sampled
+%   at rate (Hz). All the given columns (default all) without gaps are
+%   filtered together by one call to filtfilt.
+%
+%   Gaps, i.e. NaN values such as those of occluded markers, are left as
+%   they are. A column with gaps is filtered one run of finite values at a
+%   time, so that a gap doesn't spread NaN over the whole column. Runs too
+%   short to be filtered are left unfiltered.
+%
+%   Filter coefficients are designed once per rate and cutoff and kept for
+%   the life of the MATLAB process, so filtering many files of the same
+%   rate costs only the filtering itself.
+
+persistent coefficients;
+if isempty(coefficients)
+    coefficients = containers.Map();
+end
+if nargin < 4
+    columns = 1:size(values, 2);
+end
+
+key = sprintf('%.6g|%.6g', rate, cutoff);
+if ~isKey(coefficients, key)
+    [b, a] = butter(2, cutoff/(rate/2));
+    coefficients(key) = {b, a};
+end
+filter = coefficients(key);
+[b, a] = filter{:};
+
+% Filter the complete columns together.
+complete = all(isfinite(values(:, columns)), 1);
+if any(complete)
+    values(:, columns(complete)) = ...
+        filtfilt(b, a, values(:, columns(complete)));
+end
+
+% Filter each run of the columns with gaps separately.
+shortest = 3*(max(length(a), length(b)) - 1) + 1;
+for column=columns(~complete)
+    edges = diff([false; isfinite(values(:, column)); false]);
+    starts = find(edges == 1);
+    ends = find(edges == -1) - 1;
+    for i=1:length(starts)
+        if ends(i) - starts(i) + 1 >= shortest
+            values(starts(i):ends(i), column) = ...
+                filtfilt(b, a, values(starts(i):ends(i), column));
+        end
+    end
+end
+
+end